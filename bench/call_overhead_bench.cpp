@@ -0,0 +1,70 @@
+// per call overhead of the parallel_ constructs, many calls on tiny ranges with a trivial body
+
+#include "../include/bam/detail/benchsuite.hpp"
+#include "../include/bam/parallel_for.hpp"
+#include "../include/bam/parallel_reduce.hpp"
+
+#include <chrono>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+    const int call_count = 100000;
+
+    std::vector<int> data(64, 1);
+
+    typedef std::vector<int>::iterator iter;
+
+    void add_one(iter b, iter e) {
+        for(auto it = b; it != e; ++it) {
+            *it += 1;
+        }
+    }
+
+    void serial_loop() {
+        for(int i = 0; i != call_count; ++i) {
+            add_one(data.begin(), data.end());
+        }
+    }
+
+    void parallel_for_calls() {
+        for(int i = 0; i != call_count; ++i) {
+            bam::parallel_for(data.begin(), data.end(), add_one);
+        }
+    }
+
+    void parallel_for_auto_calls() {
+        for(int i = 0; i != call_count; ++i) {
+            bam::parallel_for(data.begin(), data.end(), add_one, bam::auto_partitioner());
+        }
+    }
+
+    void parallel_for_hinted_calls() {
+        for(int i = 0; i != call_count; ++i) {
+            bam::parallel_for(data.begin(), data.end(), add_one, bam::auto_partitioner().cost_hint(std::chrono::nanoseconds(1)));
+        }
+    }
+
+    void parallel_reduce_calls() {
+        long long sum = 0;
+        for(int i = 0; i != call_count; ++i) {
+            sum += bam::parallel_reduce(data.begin(), data.end(),
+                                        [] (iter b, iter e) { return std::accumulate(b, e, 0LL); },
+                                        [] (long long a, long long b) { return a + b; });
+        }
+        data[0] = static_cast<int>(sum & 1);
+    }
+}
+
+int main() {
+    bam::detail::benchsuite<std::chrono::milliseconds> suite;
+
+    suite.add("serial loop over 64 elements", serial_loop);
+    suite.add("parallel_for over 64 elements", parallel_for_calls);
+    suite.add("parallel_for over 64 elements, auto_partitioner", parallel_for_auto_calls);
+    suite.add("parallel_for over 64 elements, cost hint", parallel_for_hinted_calls);
+    suite.add("parallel_reduce over 64 elements", parallel_reduce_calls);
+
+    suite.run();
+}
@@ -0,0 +1,67 @@
+// parallel_for on a simulated hybrid cpu: every odd worker slot is throttled to 40% of the speed of the
+// others, like an efficiency core next to performance cores. Compares even initial slices with slices
+// weighted by the capacity of the thread, with a coarse and the default grainsize
+
+#include "../include/bam/detail/benchsuite.hpp"
+#include "../include/bam/parallel_for.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+    const double slow_capacity = 0.4;
+
+    std::vector<double> data(1 << 20, 1.0);
+
+    typedef std::vector<double>::iterator iter;
+
+    // slow slots repeat the work, so they need 1 / slow_capacity the time per element
+    void throttled_body(iter b, iter e) {
+        auto rounds = bam::detail::worker_pool::current_slot() % 2 ? static_cast<int>(8 / slow_capacity) : 8;
+        for(auto it = b; it != e; ++it) {
+            auto value = *it;
+            for(int r = 0; r != rounds; ++r) {
+                value = std::sqrt(value + r);
+            }
+            *it = value;
+        }
+    }
+
+    void simulate_capacities(bool weighted) {
+        auto& capacities = bam::detail::slot_capacities();
+        capacities.clear();
+        if(weighted) {
+            for(int slot = 0; slot <= bam::detail::get_worker_pool().size(); ++slot) {
+                capacities.push_back(slot % 2 ? slow_capacity : 1.0);
+            }
+        }
+    }
+
+    void coarse(bool weighted) {
+        simulate_capacities(weighted);
+        auto grainsize = static_cast<int>(data.size() / (4 * (bam::detail::get_worker_pool().size() + 1)));
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_for(data.begin(), data.end(), throttled_body, grainsize);
+        }
+    }
+
+    void default_grain(bool weighted) {
+        simulate_capacities(weighted);
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_for(data.begin(), data.end(), throttled_body);
+        }
+    }
+}
+
+int main() {
+    bam::detail::benchsuite<std::chrono::milliseconds> suite;
+
+    suite.add("coarse grain, even slices", coarse, false);
+    suite.add("coarse grain, weighted slices", coarse, true);
+    suite.add("default grainsize, even slices", default_grain, false);
+    suite.add("default grainsize, weighted slices", default_grain, true);
+
+    suite.run();
+    bam::detail::slot_capacities().clear();
+}
@@ -0,0 +1,23 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// linear victim selection for steal_tail_bench, included before any bam header it takes the place of
+// include/bam/detail/victim_selection.hpp, such that thieves always start at the first victim
+
+#ifndef BAM_VICTIM_SELECTION_HPP
+#define BAM_VICTIM_SELECTION_HPP
+
+#include <cstddef>
+
+namespace bam { namespace detail {
+
+    /**
+     * @brief index of the first victim a thief looks at, always the front of the steal pool
+     */
+    inline std::size_t first_victim(std::size_t) {
+        return 0;
+    }
+} }
+
+#endif // BAM_VICTIM_SELECTION_HPP
@@ -0,0 +1,84 @@
+// parallel_for with the default grainsize, a fine simple_partitioner and the auto_partitioner,
+// on cheap uniform work where scheduling overhead dominates and on skewed work where balance does;
+// plus repeated sweeps over the same data with and without the affinity_partitioner
+
+#include "../include/bam/detail/benchsuite.hpp"
+#include "../include/bam/parallel_for.hpp"
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+    std::vector<double> data(1 << 22, 1.0);
+
+    typedef std::vector<double>::iterator iter;
+
+    void uniform_body(iter b, iter e) {
+        for(auto it = b; it != e; ++it) {
+            *it = *it * 0.5 + 1.0;
+        }
+    }
+
+    // the first eighth of the range is a lot more expensive than the rest
+    void skewed_body(iter b, iter e) {
+        for(auto it = b; it != e; ++it) {
+            auto rounds = it - data.begin() < static_cast<std::ptrdiff_t>(data.size() / 8) ? 64 : 1;
+            for(int r = 0; r != rounds; ++r) {
+                *it = std::sqrt(*it + r);
+            }
+        }
+    }
+
+    template<void (*body)(iter, iter)>
+    void default_grain() {
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_for(data.begin(), data.end(), body);
+        }
+    }
+
+    template<void (*body)(iter, iter)>
+    void fine_simple() {
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_for(data.begin(), data.end(), body, bam::simple_partitioner(64));
+        }
+    }
+
+    template<void (*body)(iter, iter)>
+    void auto_partitioned() {
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_for(data.begin(), data.end(), body, bam::auto_partitioner());
+        }
+    }
+
+    // many sweeps over data that fits into the combined caches of all cores, like an iterative solver
+    std::vector<double> solver_data(1 << 18, 1.0);
+
+    void solver_sweeps_default() {
+        for(int i = 0; i != 500; ++i) {
+            bam::parallel_for(solver_data.begin(), solver_data.end(), uniform_body);
+        }
+    }
+
+    void solver_sweeps_affinity() {
+        bam::affinity_partitioner part;
+        for(int i = 0; i != 500; ++i) {
+            bam::parallel_for(solver_data.begin(), solver_data.end(), uniform_body, part);
+        }
+    }
+}
+
+int main() {
+    bam::detail::benchsuite<std::chrono::milliseconds> suite;
+
+    suite.add("uniform, default grainsize", default_grain<uniform_body>);
+    suite.add("uniform, simple_partitioner(64)", fine_simple<uniform_body>);
+    suite.add("uniform, auto_partitioner", auto_partitioned<uniform_body>);
+    suite.add("skewed, default grainsize", default_grain<skewed_body>);
+    suite.add("skewed, simple_partitioner(64)", fine_simple<skewed_body>);
+    suite.add("skewed, auto_partitioner", auto_partitioned<skewed_body>);
+    suite.add("500 sweeps over 2 MB, default grainsize", solver_sweeps_default);
+    suite.add("500 sweeps over 2 MB, affinity_partitioner", solver_sweeps_affinity);
+
+    suite.run();
+}
@@ -0,0 +1,79 @@
+// parallel_inclusive_scan and parallel_exclusive_scan against serial std::partial_sum, on a range which
+// streams from memory and on one which fits into the caches; plus a segmented scan over rows of 64 elements
+
+#include "../include/bam/detail/benchsuite.hpp"
+#include "../include/bam/parallel_scan.hpp"
+
+#include <numeric>
+#include <vector>
+
+namespace {
+
+    std::vector<double> data(1 << 24, 1.0);
+    std::vector<double> result(data.size());
+    std::vector<char> heads(data.size());
+
+    std::vector<double> small_data(1 << 16, 1.0);
+    std::vector<double> small_result(small_data.size());
+
+    void serial_large() {
+        for(int i = 0; i != 10; ++i) {
+            std::partial_sum(data.begin(), data.end(), result.begin());
+        }
+    }
+
+    void inclusive_large() {
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_inclusive_scan(data.begin(), data.end(), result.begin());
+        }
+    }
+
+    void exclusive_large() {
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_exclusive_scan(data.begin(), data.end(), result.begin(), 0.0);
+        }
+    }
+
+    void in_place_large() {
+        std::vector<double> copy(data);
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_inclusive_scan(copy.begin(), copy.end(), copy.begin());
+        }
+    }
+
+    void segmented_large() {
+        for(int i = 0; i != 10; ++i) {
+            bam::parallel_segmented_inclusive_scan(data.begin(), data.end(), heads.begin(), result.begin());
+        }
+    }
+
+    void serial_small() {
+        for(int i = 0; i != 1000; ++i) {
+            std::partial_sum(small_data.begin(), small_data.end(), small_result.begin());
+        }
+    }
+
+    void inclusive_small() {
+        for(int i = 0; i != 1000; ++i) {
+            bam::parallel_inclusive_scan(small_data.begin(), small_data.end(), small_result.begin());
+        }
+    }
+}
+
+int main() {
+    for(std::size_t i = 0; i < heads.size(); i += 64) {
+        heads[i] = 1;
+    }
+
+    bam::detail::benchsuite<std::chrono::milliseconds> suite;
+
+    suite.add("16M doubles, std::partial_sum", serial_large);
+    suite.add("16M doubles, parallel_inclusive_scan", inclusive_large);
+    suite.add("16M doubles, parallel_exclusive_scan", exclusive_large);
+    suite.add("16M doubles, parallel_inclusive_scan in place", in_place_large);
+    suite.add("16M doubles, parallel_segmented_inclusive_scan", segmented_large);
+    suite.add("64K doubles, std::partial_sum", serial_small);
+    suite.add("64K doubles, parallel_inclusive_scan", inclusive_small);
+
+    suite.run();
+}
@@ -0,0 +1,61 @@
+// end-of-loop tail time of parallel_for with skewed work; built twice, once with STEAL_TAIL_LINEAR
+// such that randomized victim selection can be compared against always starting at the first victim
+
+#ifdef STEAL_TAIL_LINEAR
+#include "linear_victim_selection.hpp"
+#endif
+#include "../include/bam/parallel_for.hpp"
+#include "../include/bam/timer.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+    typedef std::chrono::high_resolution_clock clock_type;
+
+    void spin_for(std::chrono::nanoseconds duration) {
+        auto end = clock_type::now() + duration;
+        while(clock_type::now() < end) {}
+    }
+
+    /**
+     * @brief runs loops in which the first quarter of the elements is ten times as expensive as the rest,
+     * returns the average idle time per participant, i.e. wall time minus busy time divided by the participants
+     */
+    double average_tail_us(int loops, int element_count) {
+        auto participants = bam::detail::get_worker_pool().size() + 1;
+        double tail_sum = 0;
+
+        for(int l = 0; l != loops; ++l) {
+            std::atomic<long long> busy_ns(0);
+            auto worker = [&] (int b, int e) {
+                auto start = clock_type::now();
+                for(int i = b; i != e; ++i) {
+                    spin_for(std::chrono::nanoseconds(i < element_count / 4 ? 2000 : 200));
+                }
+                busy_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start).count();
+            };
+
+            bam::timer<std::chrono::nanoseconds> t;
+            bam::parallel_for(0, element_count, worker);
+            auto wall_ns = t.elapsed();
+
+            tail_sum += (wall_ns - static_cast<double>(busy_ns) / participants) / 1000.0;
+        }
+
+        return tail_sum / loops;
+    }
+}
+
+int main() {
+#ifdef STEAL_TAIL_LINEAR
+    const char* mode = "linear victim selection";
+#else
+    const char* mode = "randomized victim selection";
+#endif
+    std::cout << mode << ", " << bam::detail::get_worker_pool().size() + 1 << " participants" << std::endl;
+    std::cout << "average tail per loop " << average_tail_us(200, 20000) << " us" << std::endl;
+}
@@ -0,0 +1,43 @@
+// submit to start latency of single tasks arriving at an idle task_pool, for each wait strategy
+
+#include "../include/bam/task_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    typedef std::chrono::steady_clock clock_type;
+
+    /**
+     * @brief submits one task at a time with a pause in between, such that workers run out of work,
+     * and prints median and p99 of the time until the task started running
+     */
+    void measure(const char* name, bam::wait_strategy strategy) {
+        const int samples = 2000;
+        std::vector<long long> latencies_ns;
+        latencies_ns.reserve(samples);
+
+        bam::task_pool pool(strategy);
+        for(int i = 0; i != samples; ++i) {
+            auto submitted = clock_type::now();
+            auto started = pool.add([] { return clock_type::now(); }).get();
+            latencies_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(started - submitted).count());
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        pool.wait_and_finish();
+
+        std::sort(latencies_ns.begin(), latencies_ns.end());
+        std::cout << name << ": median " << latencies_ns[samples / 2] / 1000.0 << " us, p99 "
+                  << latencies_ns[samples * 99 / 100] / 1000.0 << " us" << std::endl;
+    }
+}
+
+int main() {
+    measure("blocking", bam::wait_strategy::blocking);
+    measure("spin then park", bam::wait_strategy::spin_then_park);
+    measure("busy poll", bam::wait_strategy::busy_poll);
+}
@@ -0,0 +1,249 @@
+// contention benchmark of the lock-free work_pool deque against the former mutex guarded queue
+
+#include "../include/bam/detail/benchsuite.hpp"
+#include "../include/bam/detail/chase_lev_deque.hpp"
+#include "../include/bam/task_pool.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace {
+
+    const int item_count = 2000000;
+
+    // the queue work_pool used before, std::queue guarded by a std::mutex, stealing half of the victim
+    class mutex_queue {
+    public:
+        void push(void* item) {
+            std::lock_guard<std::mutex> lock(m);
+            queue.push(item);
+        }
+
+        bool pop(void*& item) {
+            std::lock_guard<std::mutex> lock(m);
+            return pop_unlocked(item);
+        }
+
+        bool steal(void*& item, mutex_queue& victim) {
+            std::unique_lock<std::mutex> lock1(m, std::defer_lock);
+            std::unique_lock<std::mutex> lock2(victim.m, std::defer_lock);
+            std::lock(lock1, lock2);
+
+            auto remaining_work = victim.queue.size() == 1 ? 1 : victim.queue.size() / 2;
+            while(remaining_work-- > 0) {
+                queue.push(victim.queue.front());
+                victim.queue.pop();
+            }
+
+            return pop_unlocked(item);
+        }
+
+    private:
+        std::mutex m;
+        std::queue<void*> queue;
+
+        bool pop_unlocked(void*& item) {
+            if(queue.empty()) {
+                return false;
+            }
+            item = queue.front();
+            queue.pop();
+            return true;
+        }
+    };
+
+    void* make_item(int i) {
+        return reinterpret_cast<void*>(static_cast<std::uintptr_t>(i + 1));
+    }
+
+    int thief_count() {
+        int hw = std::thread::hardware_concurrency();
+        return hw > 4 ? hw - 1 : 3;
+    }
+
+    void mutex_owner_only() {
+        mutex_queue q;
+        void* item;
+        for(int i = 0; i != item_count; ++i) {
+            q.push(make_item(i));
+            q.pop(item);
+        }
+    }
+
+    void deque_owner_only() {
+        bam::detail::chase_lev_deque<void*> q;
+        void* item;
+        for(int i = 0; i != item_count; ++i) {
+            q.push(make_item(i));
+            q.pop(item);
+        }
+    }
+
+    // owner pushes and pops in bursts while all other threads steal from it
+    void mutex_contended() {
+        mutex_queue victim;
+        std::atomic<int> consumed(0);
+        std::vector<std::thread> thieves;
+        std::vector<mutex_queue> thief_queues(thief_count());
+
+        for(auto& own : thief_queues) {
+            thieves.emplace_back([&] {
+                void* item;
+                while(consumed.load(std::memory_order_relaxed) < item_count) {
+                    if(own.pop(item) || own.steal(item, victim)) {
+                        consumed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+
+        void* item;
+        for(int i = 0; i != item_count; ++i) {
+            victim.push(make_item(i));
+            if(i % 4 == 0 && victim.pop(item)) {
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        while(victim.pop(item)) {
+            consumed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        for(auto& t : thieves) {
+            t.join();
+        }
+    }
+
+    void deque_contended() {
+        bam::detail::chase_lev_deque<void*> victim;
+        std::atomic<int> consumed(0);
+        std::vector<std::thread> thieves;
+
+        for(int i = 0; i != thief_count(); ++i) {
+            thieves.emplace_back([&] {
+                void* item;
+                while(consumed.load(std::memory_order_relaxed) < item_count) {
+                    if(victim.steal(item) == bam::detail::steal_result::success) {
+                        consumed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+
+        void* item;
+        for(int i = 0; i != item_count; ++i) {
+            victim.push(make_item(i));
+            if(i % 4 == 0 && victim.pop(item)) {
+                consumed.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        while(victim.pop(item)) {
+            consumed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        for(auto& t : thieves) {
+            t.join();
+        }
+    }
+
+    // small trivially copyable lambdas are stored inline in the deque slots, large ones are allocated
+    template<std::size_t capture_size>
+    void work_pool_push_fetch() {
+        std::vector<bam::detail::work_pool> pools(1);
+        bam::detail::function_wrapper task;
+        std::array<char, capture_size> capture = {};
+        int counter = 0;
+
+        for(int i = 0; i != item_count; ++i) {
+            pools[0].push_local([&counter, capture] { counter += capture[0] + 1; });
+            if(pools[0].try_fetch_work(task, pools)) {
+                task();
+            }
+        }
+    }
+
+    // tasks spawning tasks, which now go to the lock-free deque of the spawning worker
+    void task_pool_fan_out() {
+        std::atomic<int> counter(0);
+        bam::task_pool pool;
+        std::vector<bam::future<void>> outer;
+        for(int i = 0; i != 1000; ++i) {
+            outer.push_back(pool.add([&] {
+                for(int j = 0; j != 1000; ++j) {
+                    pool.add([&] { counter.fetch_add(1, std::memory_order_relaxed); });
+                }
+            }));
+        }
+        for(auto& f : outer) {
+            f.get();
+        }
+        pool.wait_and_finish();
+    }
+
+    // many threads submitting small tasks from outside, each producer has its own inbox shard
+    template<int producer_count>
+    void task_pool_producers() {
+        std::atomic<int> counter(0);
+        bam::task_pool pool;
+        std::vector<std::thread> producers;
+        for(int p = 0; p != producer_count; ++p) {
+            producers.emplace_back([&] {
+                for(int i = 0; i != item_count / producer_count / 4; ++i) {
+                    pool.add([&] { counter.fetch_add(1, std::memory_order_relaxed); });
+                }
+            });
+        }
+        for(auto& t : producers) {
+            t.join();
+        }
+        pool.wait_and_finish();
+    }
+
+    // batch loop waiting after every batch, the pool keeps its workers between batches
+    void task_pool_batches_wait() {
+        std::atomic<int> counter(0);
+        bam::task_pool pool;
+        for(int batch = 0; batch != 1000; ++batch) {
+            for(int i = 0; i != 100; ++i) {
+                pool.add([&] { counter.fetch_add(1, std::memory_order_relaxed); });
+            }
+            pool.wait();
+        }
+        pool.wait_and_finish();
+    }
+
+    // the same batch loop tearing down and starting the workers per batch, as wait used to do
+    void task_pool_batches_restart() {
+        std::atomic<int> counter(0);
+        for(int batch = 0; batch != 1000; ++batch) {
+            bam::task_pool pool;
+            for(int i = 0; i != 100; ++i) {
+                pool.add([&] { counter.fetch_add(1, std::memory_order_relaxed); });
+            }
+            pool.wait_and_finish();
+        }
+    }
+}
+
+int main() {
+    bam::detail::benchsuite<std::chrono::milliseconds> suite;
+
+    suite.add("mutex queue, owner push/pop", mutex_owner_only);
+    suite.add("chase-lev deque, owner push/pop", deque_owner_only);
+    suite.add("mutex queue, owner and thieves", mutex_contended);
+    suite.add("chase-lev deque, owner and thieves", deque_contended);
+    suite.add("work_pool, push/fetch of inline lambdas", work_pool_push_fetch<8>);
+    suite.add("work_pool, push/fetch of heap allocated lambdas", work_pool_push_fetch<64>);
+    suite.add("task_pool, 1000x1000 tasks spawning tasks", task_pool_fan_out);
+    suite.add("task_pool, 1 producer", task_pool_producers<1>);
+    suite.add("task_pool, 4 producers", task_pool_producers<4>);
+    suite.add("task_pool, 16 producers", task_pool_producers<16>);
+    suite.add("task_pool, 1000 batches with wait", task_pool_batches_wait);
+    suite.add("task_pool, 1000 batches with thread restart", task_pool_batches_restart);
+
+    suite.run();
+}
@@ -0,0 +1,38 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// several exceptions of one parallel_ call, thrown together
+
+#ifndef BAM_AGGREGATE_EXCEPTION_HPP
+#define BAM_AGGREGATE_EXCEPTION_HPP
+
+#include <exception>
+#include <utility>
+#include <vector>
+
+namespace bam {
+
+    /**
+     * @brief thrown by parallel_ calls whose partitioner collects exceptions, holds the exception of every
+     * chunk which failed before the call stopped
+     */
+    class aggregate_exception : public std::exception {
+    public:
+        explicit aggregate_exception(std::vector<std::exception_ptr> errors_) : errors(std::move(errors_)) {}
+
+        //! in no particular order, rethrow them with std::rethrow_exception
+        const std::vector<std::exception_ptr>& exceptions() const {
+            return errors;
+        }
+
+        const char* what() const noexcept {
+            return "bam: exceptions thrown by a parallel_ call";
+        }
+
+    private:
+        std::vector<std::exception_ptr> errors;
+    };
+}
+
+#endif // BAM_AGGREGATE_EXCEPTION_HPP
@@ -6,6 +6,7 @@
 #define BAM_ASYNC
 
 #include "detail/async_impl.hpp"
+#include "future.hpp"
 
 #include <future>
 #include <type_traits>
@@ -17,7 +18,7 @@ namespace bam {
      * @brief bam::async with std::launch::async | std::launch::deferred implicitly given 
      */
     template<typename Foo, typename ...Args, typename std::enable_if<!std::is_enum<Foo>::value, int>::type = 0    > 
-    std::future<typename std::result_of<Foo(Args...)>::type> async(Foo&& foo, Args&& ...args) {
+    bam::future<typename std::result_of<Foo(Args...)>::type> async(Foo&& foo, Args&& ...args) {
         return detail::async_impl(std::launch::async | std::launch::deferred, std::forward<Foo>(foo), std::forward<Args>(args)... );
     }
 
@@ -26,10 +27,10 @@ namespace bam {
      * @param policy std::launch policiy
      * @param foo function to run
      * @param args arguments to pass to foo
-     * @return non-blocking std::future
+     * @return non-blocking bam::future
      */
     template<typename Foo, typename ...Args>
-    std::future<typename std::result_of<Foo(Args...)>::type> async(std::launch policy, Foo&& foo, Args&& ...args) {
+    bam::future<typename std::result_of<Foo(Args...)>::type> async(std::launch policy, Foo&& foo, Args&& ...args) {
         return detail::async_impl(policy, std::forward<Foo>(foo), std::forward<Args>(args)... );
     }
 
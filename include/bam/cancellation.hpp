@@ -0,0 +1,109 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// cooperative cancellation of parallel_ calls and task_pool tasks
+
+#ifndef BAM_CANCELLATION_HPP
+#define BAM_CANCELLATION_HPP
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace bam {
+
+    /**
+     * @brief thrown by parallel_ calls whose token was cancelled and stored in the futures of skipped tasks
+     */
+    class operation_cancelled : public std::runtime_error {
+    public:
+        operation_cancelled() : std::runtime_error("bam: operation cancelled") {}
+    };
+
+    class cancellation_source;
+
+    /**
+     * @brief observes a cancellation_source; copies are cheap and all of them see the same cancellation.
+     * A default constructed token is never cancelled.
+     */
+    class cancellation_token {
+    public:
+        cancellation_token() = default;
+
+        //! a single relaxed load, cheap enough to be polled in the body of a loop
+        bool is_cancelled() const {
+            return state && state->load(std::memory_order_relaxed);
+        }
+
+        void throw_if_cancelled() const {
+            if(is_cancelled()) {
+                throw operation_cancelled();
+            }
+        }
+
+    private:
+        explicit cancellation_token(std::shared_ptr<std::atomic<bool>> state_) : state(std::move(state_)) {}
+
+        std::shared_ptr<std::atomic<bool>> state; // shared with the source, outlives it if tokens do
+
+        friend class cancellation_source;
+    };
+
+    /**
+     * @brief cancels all parallel_ calls and tasks which were handed one of its tokens
+     *
+     * Cancellation is cooperative: chunks of parallel_ calls and queued tasks which haven't started yet
+     * are skipped, running ones finish unless their body polls the token.
+     */
+    class cancellation_source {
+    public:
+        cancellation_source() : state(std::make_shared<std::atomic<bool>>(false)) {}
+
+        cancellation_token token() const {
+            return cancellation_token(state);
+        }
+
+        void cancel() {
+            state->store(true);
+        }
+
+        bool is_cancelled() const {
+            return state->load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> state;
+    };
+
+    namespace detail {
+
+        /**
+         * @brief calls function unless token was cancelled by then, in which case it throws operation_cancelled
+         */
+        template<typename function>
+        class cancellable_function {
+        public:
+            cancellable_function(cancellation_token token_, function f_) : token(std::move(token_)), f(std::move(f_)) {}
+
+            template<typename ...Args>
+            typename std::result_of<function&(Args&&...)>::type operator()(Args&& ...args) {
+                token.throw_if_cancelled();
+                return f(std::forward<Args>(args)...);
+            }
+
+        private:
+            cancellation_token token;
+            function f;
+        };
+
+        template<typename function>
+        cancellable_function<typename std::decay<function>::type> make_cancellable(const cancellation_token& token, function&& f) {
+            return cancellable_function<typename std::decay<function>::type>(token, std::forward<function>(f));
+        }
+    }
+}
+
+#endif // BAM_CANCELLATION_HPP
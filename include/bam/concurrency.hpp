@@ -0,0 +1,58 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// how many threads bam uses and where they run
+
+#ifndef BAM_CONCURRENCY_HPP
+#define BAM_CONCURRENCY_HPP
+
+#include "detail/available_cpus.hpp"
+#include "detail/topology.hpp"
+
+namespace bam {
+
+    /**
+     * @brief number of threads, including the calling one, the parallel_ constructs run on and task_pools start
+     *
+     * Defaults to the cpus the process may run on, capped by the cgroup cpu quota of its container.
+     * The environment variable BAM_MAX_CONCURRENCY overrides that, set_max_concurrency overrides both.
+     */
+    inline int max_concurrency() {
+        return detail::concurrency_limit();
+    }
+
+    /**
+     * @brief sets max_concurrency at runtime
+     *
+     * The persistent worker threads of the parallel_ constructs are started on first use with the value at
+     * that time; lowering it afterwards leaves the surplus workers idle, raising it can't go beyond that
+     * number. task_pools use the value at their construction.
+     * @param count number of threads, 0 restores the default
+     */
+    inline void set_max_concurrency(int count) {
+        detail::concurrency_override().store(count > 0 ? count : 0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief whether worker threads are pinned to cpus
+     *
+     * Pinned workers are spread over the physical cores first and only then over their smt siblings, as read
+     * from /sys/devices/system/cpu. Workers of a task_pool then steal from workers on the same core first,
+     * then from the ones sharing the L3 cache, then from the same socket and only then from other sockets.
+     * Defaults to false unless the environment variable BAM_PIN_WORKERS is set to a positive number.
+     */
+    inline bool worker_pinning() {
+        return detail::pin_workers();
+    }
+
+    /**
+     * @brief turns pinning on or off for worker threads started afterwards, i.e. the parallel_ workers if
+     * none of the parallel_ constructs ran yet and task_pools constructed afterwards
+     */
+    inline void set_worker_pinning(bool pin) {
+        detail::pin_workers_flag().store(pin, std::memory_order_relaxed);
+    }
+}
+
+#endif // BAM_CONCURRENCY_HPP
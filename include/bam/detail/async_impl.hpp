@@ -6,6 +6,7 @@
 #define BAM_ASYNC_IMPL
 
 #include "async_task_pool.hpp"
+#include "../future.hpp"
 
 #include <future>
 #include <type_traits>
@@ -28,7 +29,7 @@ namespace bam { namespace detail {
      * @param args arguments
      */
     template<typename Foo, typename ...Args>
-    std::future<typename std::result_of<Foo(Args...)>::type> async_impl(std::launch policy, Foo&& foo, Args&& ...args) {
+    bam::future<typename std::result_of<Foo(Args...)>::type> async_impl(std::launch policy, Foo&& foo, Args&& ...args) {
         bam::detail::async_task_pool& pool = get_pool();
   
         if((policy ^ (std::launch::async | std::launch::deferred))  == std::launch()) {
@@ -38,14 +39,14 @@ namespace bam { namespace detail {
                 return std::move(std::get<1>(tuple));
             }
             else {
-                return std::async(std::launch::deferred, std::forward<Foo>(foo), std::forward<Args>(args)...);
+                return detail::make_deferred_future(std::forward<Foo>(foo), std::forward<Args>(args)...);
             }
         }
         else if ((policy & std::launch::async) != std::launch()) {
             return pool.add(std::forward<Foo>(foo), std::forward<Args>(args)...);
         }
         else if ((policy & std::launch::deferred) != std::launch()) {
-            return std::async(std::launch::deferred, std::forward<Foo>(foo), std::forward<Args>(args)...);
+            return detail::make_deferred_future(std::forward<Foo>(foo), std::forward<Args>(args)...);
         }
         else {
             return pool.add(std::forward<Foo>(foo), std::forward<Args>(args)...);
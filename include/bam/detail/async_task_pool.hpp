@@ -12,27 +12,33 @@ namespace bam { namespace detail {
 
     class async_task_pool {
     public:
+        /**
+         * @brief adds the task only if the inbox of the calling thread is empty
+         * @return true and the future of the task, or false and an invalid future; f and args are left untouched in that case
+         */
         template<typename function, typename ...Args>
-        std::tuple<bool, std::future<typename std::result_of<function(Args...)>::type>> try_add(function&& f, Args&&... args) {
+        std::tuple<bool, bam::future<typename std::result_of<function(Args...)>::type>> try_add(function&& f, Args&&... args) {
             assert(pool.done == false);
             typedef typename std::result_of<function(Args...)>::type return_type;
-    
-            auto bound_task = std::bind(std::forward<function>(f), std::forward<Args>(args)...);
-            std::packaged_task<return_type()> task(std::move(bound_task));
-            auto ret = task.get_future();
-    
-    
-            if(pool.work[0].try_push_back(std::move(task))) {
-                pool.sem.post();  
-                return std::make_tuple(true, std::move(ret));
-            } 
-            else {
-                return std::make_tuple(false, std::future<return_type>());
+
+            // f and args are only consumed once the inbox was found empty, under its lock
+            bam::future<return_type> ret;
+            auto added = pool.work[pool.submission_shard()].try_push_back([&] () -> function_wrapper {
+                auto task_and_future = detail::make_promised_task(std::forward<function>(f), std::forward<Args>(args)...);
+                ret = std::move(task_and_future.second);
+                pool.pending.fetch_add(1);
+                return function_wrapper(std::move(task_and_future.first));
+            });
+            if(!added) {
+                return std::make_tuple(false, bam::future<return_type>());
             }
+
+            pool.events.notify_one();
+            return std::make_tuple(true, std::move(ret));
         }
-  
+
         template<typename function, typename ...Args>
-        std::future<typename std::result_of<function(Args...)>::type> add(function&& f, Args&&... args) {
+        bam::future<typename std::result_of<function(Args...)>::type> add(function&& f, Args&&... args) {
             return pool.add(std::forward<function>(f), std::forward<Args>(args)...);
         }
   
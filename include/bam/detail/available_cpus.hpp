@@ -0,0 +1,261 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// number of cpus the process may actually use, taking affinity masks and container cpu quotas into account
+
+#ifndef BAM_AVAILABLE_CPUS_HPP
+#define BAM_AVAILABLE_CPUS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace bam { namespace detail {
+
+    //! used if neither the hardware nor the os tell us anything
+    static const int fallback_cpu_count = 8;
+
+    /**
+     * @brief number of cpus a quota of quota per period allows to use, rounded up
+     * @return 0 if there is no quota
+     */
+    inline int cpus_of_quota(long long quota, long long period) {
+        if(quota <= 0 || period <= 0) {
+            return 0;
+        }
+        return static_cast<int>(std::max((quota + period - 1) / period, 1LL));
+    }
+
+    /**
+     * @brief parses the content of a cgroup v2 cpu.max file, e.g. "400000 100000" or "max 100000"
+     * @return number of cpus, 0 if there is no quota
+     */
+    inline int parse_cpu_max(const std::string& content) {
+        std::istringstream in(content);
+        std::string quota;
+        long long period = 0;
+        if(!(in >> quota >> period) || quota == "max") {
+            return 0;
+        }
+        return cpus_of_quota(std::atoll(quota.c_str()), period);
+    }
+
+    /**
+     * @brief finds the cgroup of the process in the content of /proc/self/cgroup
+     * @param controller cgroup v1 controller like "cpu", empty for the unified cgroup v2 hierarchy
+     * @return path of the cgroup, empty if the process isn't in such a cgroup
+     */
+    inline std::string parse_cgroup_path(const std::string& content, const std::string& controller) {
+        std::istringstream in(content);
+        std::string line;
+        while(std::getline(in, line)) {
+            // hierarchy-id:controller-list:path
+            auto first = line.find(':');
+            auto second = first == std::string::npos ? first : line.find(':', first + 1);
+            if(second == std::string::npos) {
+                continue;
+            }
+
+            std::string controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+            if(controller.empty() ? controllers == ",," : controllers.find("," + controller + ",") != std::string::npos) {
+                return line.substr(second + 1);
+            }
+        }
+        return std::string();
+    }
+
+    /**
+     * @brief parses the content of BAM_MAX_CONCURRENCY
+     * @return the positive number it holds, 0 if it is anything else
+     */
+    inline int parse_concurrency(const char* value) {
+        if(!value) {
+            return 0;
+        }
+
+        char* end = nullptr;
+        errno = 0;
+        auto count = std::strtol(value, &end, 10);
+        if(end == value || *end != '\0' || errno != 0 || count <= 0 || count > 1 << 16) {
+            return 0;
+        }
+        return static_cast<int>(count);
+    }
+
+    //! whole content of a small file, empty if it can't be read
+    inline std::string read_file(const std::string& path) {
+        std::ifstream in(path);
+        std::ostringstream content;
+        content << in.rdbuf();
+        return in ? content.str() : std::string();
+    }
+
+    /**
+     * @brief parses a cpu list like "0-3,8,10-11" as found in sysfs
+     */
+    inline std::vector<int> parse_cpu_list(const std::string& list) {
+        std::vector<int> cpus;
+        std::istringstream in(list);
+        std::string item;
+        while(std::getline(in, item, ',')) {
+            if(item.find_first_of("0123456789") == std::string::npos) {
+                continue;
+            }
+            auto dash = item.find('-');
+            auto first = std::atoi(item.c_str());
+            auto last = dash == std::string::npos ? first : std::atoi(item.c_str() + dash + 1);
+            for(auto cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
+    }
+
+#ifdef __linux__
+    /**
+     * @brief number of cpus in the affinity mask of the process
+     * @return 0 if it can't be determined
+     */
+    inline int affinity_cpus() {
+        for(int cpus = 1024; cpus <= 1 << 16; cpus *= 2) {
+            auto set = CPU_ALLOC(cpus);
+            if(!set) {
+                return 0;
+            }
+
+            auto size = CPU_ALLOC_SIZE(cpus);
+            CPU_ZERO_S(size, set);
+            auto ret = sched_getaffinity(0, size, set);
+            auto count = CPU_COUNT_S(size, set);
+            CPU_FREE(set);
+
+            if(ret == 0) {
+                return count;
+            }
+            if(errno != EINVAL) { // EINVAL means the mask is bigger than ours
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief smallest cpu quota of the cgroup at path and all its parents
+     * @param read_quota returns the quota of the cgroup directory it is passed, 0 if there is none
+     * @return number of cpus, 0 if there is no quota
+     */
+    template<typename ReadQuota>
+    int smallest_quota(const std::string& root, std::string path, ReadQuota read_quota) {
+        int cpus = 0;
+        while(true) {
+            auto quota = read_quota(root + path);
+            if(quota != 0) {
+                cpus = cpus ? std::min(cpus, quota) : quota;
+            }
+            if(path.empty() || path == "/") {
+                return cpus;
+            }
+            path.erase(path.find_last_of('/'));
+        }
+    }
+
+    /**
+     * @brief number of cpus the cgroup v2 or v1 cpu quota of the process allows
+     * @return 0 if there is no quota
+     */
+    inline int quota_cpus() {
+        auto cgroups = read_file("/proc/self/cgroup");
+
+        // cgroup v2, the unified hierarchy
+        auto path = parse_cgroup_path(cgroups, "");
+        if(!path.empty()) {
+            auto cpus = smallest_quota("/sys/fs/cgroup", path, [] (const std::string& dir) {
+                return parse_cpu_max(read_file(dir + "/cpu.max"));
+            });
+            if(cpus) {
+                return cpus;
+            }
+        }
+
+        // cgroup v1, the cpu controller is mounted on its own or together with cpuacct
+        path = parse_cgroup_path(cgroups, "cpu");
+        if(path.empty()) {
+            return 0;
+        }
+        auto read_cfs = [] (const std::string& dir) {
+            return cpus_of_quota(std::atoll(read_file(dir + "/cpu.cfs_quota_us").c_str()),
+                                 std::atoll(read_file(dir + "/cpu.cfs_period_us").c_str()));
+        };
+        for(auto mount : { "/sys/fs/cgroup/cpu", "/sys/fs/cgroup/cpu,cpuacct", "/sys/fs/cgroup/cpuacct,cpu" }) {
+            // inside a container the path is the one of the host, which doesn't exist there, but the
+            // mount itself is the cgroup of the container and checked as the last parent
+            if(!read_file(std::string(mount) + "/cpu.cfs_period_us").empty()) {
+                return smallest_quota(mount, path, read_cfs);
+            }
+        }
+        return 0;
+    }
+#else
+    inline int affinity_cpus() {
+        return 0;
+    }
+
+    inline int quota_cpus() {
+        return 0;
+    }
+#endif
+
+    /**
+     * @brief number of cpus the process can make use of: the cpus it is allowed to run on, capped by the
+     * cpu quota of its container
+     */
+    inline int available_cpus() {
+        int cpus = std::thread::hardware_concurrency();
+        if(auto affinity = affinity_cpus()) {
+            cpus = affinity;
+        }
+        if(auto quota = quota_cpus()) {
+            cpus = cpus ? std::min(cpus, quota) : quota;
+        }
+        return cpus ? cpus : fallback_cpu_count;
+    }
+
+    /**
+     * @brief number of threads the worker pools and parallel_ calls use, see bam::set_max_concurrency
+     */
+    inline int default_concurrency() {
+        static const int concurrency = [] {
+            auto requested = parse_concurrency(std::getenv("BAM_MAX_CONCURRENCY"));
+            return requested ? requested : available_cpus();
+        }();
+        return concurrency;
+    }
+
+    //! set by bam::set_max_concurrency, 0 if unset
+    inline std::atomic<int>& concurrency_override() {
+        static std::atomic<int> concurrency(0);
+        return concurrency;
+    }
+
+    /**
+     * @brief number of threads, including the calling one, parallel_ calls and pools should use
+     */
+    inline int concurrency_limit() {
+        auto requested = concurrency_override().load(std::memory_order_relaxed);
+        return requested ? requested : default_concurrency();
+    }
+} }
+
+#endif // BAM_AVAILABLE_CPUS_HPP
@@ -8,6 +8,8 @@
 #include<vector>
 #include<functional>
 #include<utility>
+#include<string>
+#include<iostream>
 
 #include "../timer.hpp"
 
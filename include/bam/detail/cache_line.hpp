@@ -0,0 +1,29 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BAM_CACHE_LINE_HPP
+#define BAM_CACHE_LINE_HPP
+
+#include <cstddef>
+#include <utility>
+
+namespace bam { namespace detail {
+
+    //! assumed size of a cache line, true for all current x86 and most ARM cores
+    static const std::size_t cache_line_size = 64;
+
+    /**
+     * @brief pads value to fill whole cache lines, such that it doesn't share one with the following member
+     */
+    template<typename T>
+    struct cache_padded {
+        template<typename ...Args>
+        explicit cache_padded(Args&& ...args) : value(std::forward<Args>(args)...) {}
+
+        T value;
+        char padding[cache_line_size - sizeof(T) % cache_line_size];
+    };
+} }
+
+#endif // BAM_CACHE_LINE_HPP
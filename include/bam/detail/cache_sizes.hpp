@@ -0,0 +1,98 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// sizes of the private caches, the default grainsize keeps chunks within them
+
+#ifndef BAM_CACHE_SIZES_HPP
+#define BAM_CACHE_SIZES_HPP
+
+#include "available_cpus.hpp"
+#include "topology.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+namespace bam { namespace detail {
+
+    /**
+     * @brief data cache sizes of one core in bytes
+     */
+    struct cache_sizes {
+        std::size_t l1d;
+        std::size_t l2;
+    };
+
+    //! used if sysfs doesn't tell, small enough for every x86 core of the last decade
+    static const cache_sizes default_cache_sizes = { 32 * 1024, 256 * 1024 };
+
+    /**
+     * @brief parses the size file of a sysfs cache, e.g. "48K"
+     * @return size in bytes, 0 if content is no size
+     */
+    inline std::size_t parse_cache_size(const std::string& content) {
+        char* suffix = nullptr;
+        auto size = std::strtoul(content.c_str(), &suffix, 10);
+        if(suffix == content.c_str()) {
+            return 0;
+        }
+        switch(*suffix) {
+            case 'K': return size * 1024;
+            case 'M': return size * 1024 * 1024;
+            case 'G': return size * 1024 * 1024 * 1024;
+            default: return size;
+        }
+    }
+
+    /**
+     * @brief reads the L1 data and L2 cache of cpu from /sys/devices/system/cpu, missing ones are taken
+     * from default_cache_sizes
+     */
+    inline cache_sizes read_cache_sizes(int cpu) {
+        auto dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/cache/index";
+        auto sizes = default_cache_sizes;
+        bool l1d_found = false;
+        bool l2_found = false;
+        for(int index = 0; ; ++index) {
+            auto level = read_file(dir + std::to_string(index) + "/level");
+            if(level.empty()) {
+                break;
+            }
+            auto type = read_file(dir + std::to_string(index) + "/type");
+            auto size = parse_cache_size(read_file(dir + std::to_string(index) + "/size"));
+            if(size == 0 || type.compare(0, 11, "Instruction") == 0) {
+                continue;
+            }
+            if(std::atoi(level.c_str()) == 1 && !l1d_found) {
+                sizes.l1d = size;
+                l1d_found = true;
+            }
+            else if(std::atoi(level.c_str()) == 2 && !l2_found) {
+                sizes.l2 = size;
+                l2_found = true;
+            }
+        }
+        return sizes;
+    }
+
+    /**
+     * @brief smallest caches among the cpus of the process, read once; on hybrid cpus these are the ones of
+     * the efficiency cores, such that chunks fit the caches of either kind
+     */
+    inline const cache_sizes& get_cache_sizes() {
+        static const cache_sizes sizes = [] {
+            auto smallest = read_cache_sizes(get_topology().front().cpu);
+            for(auto& info : get_topology()) {
+                auto cpu_sizes = read_cache_sizes(info.cpu);
+                smallest.l1d = std::min(smallest.l1d, cpu_sizes.l1d);
+                smallest.l2 = std::min(smallest.l2, cpu_sizes.l2);
+            }
+            return smallest;
+        }();
+        return sizes;
+    }
+} }
+
+#endif // BAM_CACHE_SIZES_HPP
@@ -0,0 +1,180 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// lock-free work stealing deque by Chase and Lev, memory orderings as in
+// "Correct and Efficient Work-Stealing for Weak Memory Models" by Le, Pop, Cohen and Zappa Nardelli
+
+#ifndef BAM_CHASE_LEV_DEQUE_HPP
+#define BAM_CHASE_LEV_DEQUE_HPP
+
+#include "cache_line.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace bam { namespace detail {
+
+    enum class steal_result { success, empty, abort };
+
+    /**
+     * @brief single producer deque; the owner pushes and pops at the bottom, thieves steal from the top
+     * @tparam T trivially copyable item type, stored inline in the slots
+     */
+    template<typename T>
+    class chase_lev_deque {
+        static_assert(std::is_trivially_copyable<T>::value, "chase_lev_deque items are copied by atomic loads and stores");
+
+        /**
+         * @brief ring buffer, grows by copying into a buffer of twice the size
+         *
+         * Items larger than a word are split into words which are loaded and stored one by one. A thief may
+         * thereby read a torn item while the owner reuses the slot, but then its CAS on top fails and the
+         * item is thrown away unused.
+         */
+        class circular_array {
+        public:
+            static const std::size_t words = (sizeof(T) + sizeof(std::uintptr_t) - 1) / sizeof(std::uintptr_t);
+
+            explicit circular_array(int log_size_) : log_size(log_size_), items(new std::atomic<std::uintptr_t>[words << log_size_]) {}
+
+            std::int64_t size() const {
+                return std::int64_t(1) << log_size;
+            }
+
+            T get(std::int64_t i) const {
+                std::uintptr_t buffer[words];
+                auto slot = &items[(i & (size() - 1)) * words];
+                for(auto w = 0u; w != words; ++w) {
+                    buffer[w] = slot[w].load(std::memory_order_relaxed);
+                }
+
+                T ret;
+                std::memcpy(&ret, buffer, sizeof(T));
+                return ret;
+            }
+
+            void put(std::int64_t i, const T& item) {
+                std::uintptr_t buffer[words] = {};
+                std::memcpy(buffer, &item, sizeof(T));
+
+                auto slot = &items[(i & (size() - 1)) * words];
+                for(auto w = 0u; w != words; ++w) {
+                    slot[w].store(buffer[w], std::memory_order_relaxed);
+                }
+            }
+
+            circular_array* grow(std::int64_t bottom, std::int64_t top) const {
+                auto ret = new circular_array(log_size + 1);
+                for(auto i = top; i != bottom; ++i) {
+                    ret->put(i, get(i));
+                }
+                return ret;
+            }
+
+        private:
+            const int log_size;
+            std::unique_ptr<std::atomic<std::uintptr_t>[]> items;
+        };
+
+    public:
+        chase_lev_deque() : top(0), bottom(0), array(new circular_array(initial_log_size)) {
+            retired.emplace_back(array.load(std::memory_order_relaxed));
+        }
+
+        chase_lev_deque(const chase_lev_deque&) = delete;
+        chase_lev_deque& operator=(const chase_lev_deque&) = delete;
+
+        /**
+         * @brief adds item at the bottom, owner only
+         */
+        void push(const T& item) {
+            auto b = bottom.load(std::memory_order_relaxed);
+            auto t = top.value.load(std::memory_order_acquire);
+            auto a = array.load(std::memory_order_relaxed);
+
+            if(b - t > a->size() - 1) {
+                std::unique_ptr<circular_array> grown(a->grow(b, t));
+                // thieves may still read from the old array, it is freed together with the deque
+                retired.push_back(std::move(grown));
+                a = retired.back().get();
+                array.store(a, std::memory_order_release);
+            }
+
+            a->put(b, item);
+            bottom.store(b + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief takes the most recently pushed item, owner only
+         * @return false if the deque was empty
+         */
+        bool pop(T& ret) {
+            auto b = bottom.load(std::memory_order_relaxed) - 1;
+            auto a = array.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t = top.value.load(std::memory_order_relaxed);
+
+            if(t > b) {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            ret = a->get(b);
+            if(t == b) {
+                // last item, race against thieves
+                auto won = top.value.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief takes the oldest item, may be called by any thread
+         * @return steal_result::abort if another thread won the race for the item, retrying might succeed
+         */
+        steal_result steal(T& ret) {
+            auto t = top.value.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto b = bottom.load(std::memory_order_acquire);
+
+            if(t >= b) {
+                return steal_result::empty;
+            }
+
+            auto a = array.load(std::memory_order_acquire);
+            auto item = a->get(t);
+            if(!top.value.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                return steal_result::abort;
+            }
+
+            ret = item;
+            return steal_result::success;
+        }
+
+        /**
+         * @brief approximation of emptiness, exact only when called by the owner without concurrent thieves
+         */
+        bool empty() const {
+            return bottom.load(std::memory_order_relaxed) <= top.value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static const int initial_log_size = 6;
+
+        cache_padded<std::atomic<std::int64_t>> top; // keeps thieves and owner off each others cache line
+        std::atomic<std::int64_t> bottom;
+        std::atomic<circular_array*> array;
+        std::vector<std::unique_ptr<circular_array>> retired;
+    };
+} }
+
+#endif // BAM_CHASE_LEV_DEQUE_HPP
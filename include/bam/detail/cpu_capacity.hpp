@@ -0,0 +1,165 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// relative speed of the cpus, such that slower cores of hybrid cpus get smaller slices of a range
+
+#ifndef BAM_CPU_CAPACITY_HPP
+#define BAM_CPU_CAPACITY_HPP
+
+#include "available_cpus.hpp"
+#include "topology.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace bam { namespace detail {
+
+    //! rough work per cycle of an efficiency core compared to a performance core of the same hybrid cpu
+    static const double efficiency_core_ipc = 0.75;
+
+    /**
+     * @brief capacities of cpu_capacity files or the cpu_core/cpu_atom lists of hybrid intel cpus
+     * @param cpu_capacity contents of /sys/devices/system/cpu/cpuN/cpu_capacity, indexed by cpu, empty if missing
+     * @param atom_cpus cpus listed in /sys/devices/cpu_atom/cpus
+     * @param atom_ratio speed of an atom cpu relative to a core cpu
+     * @return capacity of every cpu relative to the fastest one, all 1 if nothing is known
+     */
+    inline std::vector<double> parse_capacities(const std::vector<std::string>& cpu_capacity, const std::vector<int>& atom_cpus, double atom_ratio) {
+        std::vector<double> capacities(cpu_capacity.size(), 1.0);
+
+        double fastest = 0;
+        for(auto& c : cpu_capacity) {
+            fastest = std::max(fastest, std::atof(c.c_str()));
+        }
+        if(fastest > 0) {
+            for(auto cpu = 0u; cpu != cpu_capacity.size(); ++cpu) {
+                auto capacity = std::atof(cpu_capacity[cpu].c_str());
+                capacities[cpu] = capacity > 0 ? capacity / fastest : 1.0;
+            }
+            return capacities;
+        }
+
+        for(auto cpu : atom_cpus) {
+            if(cpu >= 0 && cpu < static_cast<int>(capacities.size())) {
+                capacities[cpu] = atom_ratio;
+            }
+        }
+        return capacities;
+    }
+
+    /**
+     * @brief capacity of every cpu relative to the fastest one, indexed by cpu and read once from sysfs
+     */
+    inline const std::vector<double>& cpu_capacities() {
+        static const std::vector<double> capacities = [] {
+            int cpu_count = 0;
+            for(auto& info : get_topology()) {
+                cpu_count = std::max(cpu_count, info.cpu + 1);
+            }
+
+            std::vector<std::string> cpu_capacity;
+            auto cpu_dir = [] (int cpu) { return "/sys/devices/system/cpu/cpu" + std::to_string(cpu); };
+            for(int cpu = 0; cpu != cpu_count; ++cpu) {
+                cpu_capacity.push_back(read_file(cpu_dir(cpu) + "/cpu_capacity"));
+            }
+
+            // hybrid intel cpus without cpu_capacity: efficiency cores clock lower and do less per cycle
+            auto atom_cpus = parse_cpu_list(read_file("/sys/devices/cpu_atom/cpus"));
+            auto core_cpus = parse_cpu_list(read_file("/sys/devices/cpu_core/cpus"));
+            double atom_ratio = efficiency_core_ipc;
+            if(!atom_cpus.empty() && !core_cpus.empty()) {
+                auto atom_freq = std::atof(read_file(cpu_dir(atom_cpus.front()) + "/cpufreq/cpuinfo_max_freq").c_str());
+                auto core_freq = std::atof(read_file(cpu_dir(core_cpus.front()) + "/cpufreq/cpuinfo_max_freq").c_str());
+                if(atom_freq > 0 && core_freq > 0) {
+                    atom_ratio *= std::min(atom_freq / core_freq, 1.0);
+                }
+            }
+
+            return parse_capacities(cpu_capacity, atom_cpus, atom_ratio);
+        }();
+        return capacities;
+    }
+
+    /**
+     * @brief capacities by worker slot which replace the detected ones, to simulate hybrid cpus in tests and
+     * benchmarks; should cover slot 0 to the number of workers and only be changed while no parallel_ call runs
+     */
+    inline std::vector<double>& slot_capacities() {
+        static std::vector<double> capacities;
+        return capacities;
+    }
+
+    inline double capacity_of_cpu(int cpu) {
+        auto& capacities = cpu_capacities();
+        return cpu >= 0 && cpu < static_cast<int>(capacities.size()) ? capacities[cpu] : 1.0;
+    }
+
+    /**
+     * @brief capacity of the calling thread relative to the fastest cpu
+     */
+    inline double thread_capacity() {
+        auto slot = worker_pool::current_slot();
+        auto& overrides = slot_capacities();
+        if(!overrides.empty()) {
+            return slot < static_cast<int>(overrides.size()) ? overrides[slot] : 1.0;
+        }
+        if(slot != 0 && pin_workers()) {
+            return capacity_of_cpu(worker_cpu(slot).cpu);
+        }
+#ifdef __linux__
+        return capacity_of_cpu(sched_getcpu());
+#else
+        return 1.0;
+#endif
+    }
+
+    /**
+     * @brief average of capacities, 0 if all of them are about the same
+     */
+    inline double mean_if_unequal(const std::vector<double>& capacities) {
+        if(capacities.empty()) {
+            return 0;
+        }
+
+        auto range = std::minmax_element(capacities.begin(), capacities.end());
+        if(*range.first > 0.95 * *range.second) {
+            return 0;
+        }
+
+        double sum = 0;
+        for(auto c : capacities) {
+            sum += c;
+        }
+        return sum / capacities.size();
+    }
+
+    /**
+     * @brief average capacity of the threads taking part in parallel_ calls, 0 if all of them are equally
+     * fast, such that ranges are split evenly
+     */
+    inline double mean_capacity() {
+        auto& overrides = slot_capacities();
+        if(!overrides.empty()) {
+            return mean_if_unequal(overrides);
+        }
+
+        static const double detected = [] {
+            std::vector<double> capacities;
+            for(auto& info : get_topology()) {
+                capacities.push_back(capacity_of_cpu(info.cpu));
+            }
+            return mean_if_unequal(capacities);
+        }();
+        return detected;
+    }
+} }
+
+#endif // BAM_CPU_CAPACITY_HPP
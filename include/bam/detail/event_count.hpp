@@ -0,0 +1,135 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BAM_EVENT_COUNT_HPP
+#define BAM_EVENT_COUNT_HPP
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace bam { namespace detail {
+
+    //! hint to the cpu that we are busy waiting
+    inline void cpu_relax() {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    /**
+     * @brief eventcount, lets threads park until notified without the notifier paying for a syscall
+     * if nobody is parked
+     *
+     * A thread which wants to park calls prepare_wait, checks its condition once more and then either
+     * calls cancel_wait or wait with the returned key. Notifications in between are not lost.
+     * The upper 32 bits of the state are an epoch which is bumped on every notify, the lower 32 bits
+     * count the threads between prepare_wait and the end of wait/cancel_wait.
+     */
+    class event_count {
+    public:
+        typedef std::uint32_t key_type;
+
+        event_count() : state(0) {}
+
+        event_count(const event_count&) = delete;
+        event_count& operator=(const event_count&) = delete;
+
+        key_type prepare_wait() {
+            return state.fetch_add(add_waiter, std::memory_order_seq_cst) >> epoch_shift;
+        }
+
+        void cancel_wait() {
+            state.fetch_sub(add_waiter, std::memory_order_seq_cst);
+        }
+
+        //! parks until the epoch moved past key
+        void wait(key_type key) {
+            while(epoch() == key) {
+                park(key);
+            }
+            state.fetch_sub(add_waiter, std::memory_order_seq_cst);
+        }
+
+        void notify_one() {
+            notify(1);
+        }
+
+        void notify_all() {
+            notify(INT_MAX);
+        }
+
+    private:
+        static const std::uint64_t add_waiter = 1;
+        static const std::uint64_t waiter_mask = 0xffffffff;
+        static const int epoch_shift = 32;
+        static const std::uint64_t add_epoch = std::uint64_t(1) << epoch_shift;
+
+        std::atomic<std::uint64_t> state;
+#ifndef __linux__
+        std::mutex m;
+        std::condition_variable cv;
+#endif
+
+        key_type epoch() const {
+            return state.load(std::memory_order_acquire) >> epoch_shift;
+        }
+
+        void notify(int count) {
+            auto prev = state.fetch_add(add_epoch, std::memory_order_seq_cst);
+            if(prev & waiter_mask) {
+                wake(count);
+            }
+        }
+
+#ifdef __linux__
+        //! the futex lives on the epoch half of the state
+        int* epoch_address() {
+            static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t), "futex needs a plain 64 bit state");
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return reinterpret_cast<int*>(&state) + 1;
+#else
+            return reinterpret_cast<int*>(&state);
+#endif
+        }
+
+        void park(key_type key) {
+            syscall(SYS_futex, epoch_address(), FUTEX_WAIT_PRIVATE, static_cast<int>(key), nullptr, nullptr, 0);
+        }
+
+        void wake(int count) {
+            syscall(SYS_futex, epoch_address(), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+        }
+#else
+        void park(key_type key) {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&] { return epoch() != key; });
+        }
+
+        void wake(int count) {
+            std::lock_guard<std::mutex> lock(m);
+            if(count == 1) {
+                cv.notify_one();
+            }
+            else {
+                cv.notify_all();
+            }
+        }
+#endif
+    };
+} }
+
+#endif // BAM_EVENT_COUNT_HPP
@@ -0,0 +1,120 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BAM_FIXED_VECTOR_HPP
+#define BAM_FIXED_VECTOR_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bam { namespace detail {
+
+    /**
+     * @brief contiguous container whose capacity is set once; up to inline_capacity elements live inside
+     * the object itself, such that per call state on the stack needs no allocation
+     *
+     * Elements are never moved, so they may be atomics, and over-aligned element types keep their
+     * alignment on the heap as well.
+     */
+    template<typename T, std::size_t inline_capacity>
+    class fixed_vector {
+    public:
+        typedef T value_type;
+        typedef T* iterator;
+        typedef std::size_t size_type;
+
+        fixed_vector() : data_(inline_data()), size_(0), capacity_(inline_capacity), heap(nullptr) {}
+
+        //! constructs count default constructed elements
+        explicit fixed_vector(size_type count) : fixed_vector() {
+            reserve(count);
+            while(size_ != count) {
+                emplace_back();
+            }
+        }
+
+        ~fixed_vector() {
+            for(auto it = begin(); it != end(); ++it) {
+                it->~T();
+            }
+            ::operator delete(heap);
+        }
+
+        fixed_vector(const fixed_vector&) = delete;
+        fixed_vector& operator=(const fixed_vector&) = delete;
+
+        /**
+         * @brief sets the capacity, only allowed while the vector is empty; a count above inline_capacity moves
+         * the elements to one heap allocation
+         */
+        void reserve(size_type count) {
+            assert(size_ == 0);
+            if(count <= capacity_) {
+                return;
+            }
+
+            ::operator delete(heap);
+            heap = ::operator new(count * sizeof(T) + alignof(T));
+            auto address = reinterpret_cast<std::uintptr_t>(heap);
+            data_ = reinterpret_cast<T*>((address + alignof(T) - 1) / alignof(T) * alignof(T));
+            capacity_ = count;
+        }
+
+        template<typename ...Args>
+        void emplace_back(Args&& ...args) {
+            assert(size_ < capacity_);
+            new (data_ + size_) T(std::forward<Args>(args)...);
+            ++size_;
+        }
+
+        T& operator[](size_type index) {
+            return data_[index];
+        }
+
+        const T& operator[](size_type index) const {
+            return data_[index];
+        }
+
+        iterator begin() {
+            return data_;
+        }
+
+        iterator end() {
+            return data_ + size_;
+        }
+
+        const T* begin() const {
+            return data_;
+        }
+
+        const T* end() const {
+            return data_ + size_;
+        }
+
+        size_type size() const {
+            return size_;
+        }
+
+        bool empty() const {
+            return size_ == 0;
+        }
+
+    private:
+        typename std::aligned_storage<sizeof(T) * inline_capacity, alignof(T)>::type storage;
+        T* data_;
+        size_type size_;
+        size_type capacity_;
+        void* heap;
+
+        T* inline_data() {
+            return reinterpret_cast<T*>(&storage);
+        }
+    };
+} }
+
+#endif // BAM_FIXED_VECTOR_HPP
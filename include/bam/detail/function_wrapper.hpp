@@ -1,42 +1,165 @@
-// PIMPL/boost::any style function wrapper by Anthony Williams from C++ Concurrency in Action
+// Small buffer optimized function wrapper, based on the PIMPL/boost::any style function wrapper by
+// Anthony Williams from C++ Concurrency in Action
 
 #ifndef FUNCTION_WRAPPER_HPP
 #define FUNCTION_WRAPPER_HPP
 
-#include <memory>
+#include <cstddef>
+#include <new>
+#include <type_traits>
 #include <utility>
 
 namespace bam { namespace detail {
 
+    /**
+     * @brief whether a callable has an abandon() member, which function_wrapper calls right before it destroys
+     * the callable; callables which ran already are expected to ignore it
+     */
+    template<typename F>
+    class has_abandon {
+        template<typename U>
+        static auto test(U* u) -> decltype(u->abandon(), std::true_type());
+
+        template<typename U>
+        static std::false_type test(...);
+
+    public:
+        static const bool value = decltype(test<F>(nullptr))::value;
+    };
+
+    /**
+     * @brief move only wrapper for void() callables
+     *
+     * Trivially copyable callables of up to inline_size bytes - most lambdas capturing references,
+     * pointers and numbers - are stored inline and need no allocation. All others live on the heap.
+     * Either way the wrapper itself stays trivially copyable, which lets lock-free queues move it
+     * around as plain words; see release and adopt. Callables with an abandon() member get it called
+     * before they are destroyed, such that one dropped without having run, e.g. by a pool destroyed before
+     * getting to it, can tell whoever waits for it.
+     */
     class function_wrapper
     {
-        struct impl_base {
-            virtual void call()=0;
-            virtual ~impl_base() {}
-        };
+    public:
+        static const std::size_t inline_size = 48;
 
-        std::unique_ptr<impl_base> impl;
-        template<typename F>
-        struct impl_type: impl_base {
-            F f;
-            impl_type(F&& f_): f(std::move(f_)) {}
-            void call() { f(); }
+        //! representation of a function_wrapper, dispatches through function pointers instead of a vtable
+        struct raw_type {
+            typename std::aligned_storage<inline_size>::type storage;
+            void (*invoke)(void*);
+            void (*destroy)(void*); // null for callables stored inline, unless they have to be abandoned
         };
-    public:
+
         template<typename F>
-        function_wrapper(F&& f): impl(new impl_type<F>(std::move(f))) {}
-        function_wrapper() = default;
-        function_wrapper(function_wrapper&& other): impl(std::move(other.impl)) {}
+        function_wrapper(F&& f) {
+            typedef typename std::decay<F>::type functor;
+            typedef std::integral_constant<bool,
+                std::is_trivially_copyable<functor>::value &&
+                sizeof(functor) <= inline_size &&
+                alignof(functor) <= alignof(decltype(raw.storage))> fits_inline;
+
+            store<functor>(std::forward<F>(f), fits_inline());
+        }
+
+        function_wrapper() {
+            raw.invoke = nullptr;
+            raw.destroy = nullptr;
+        }
+
+        function_wrapper(function_wrapper&& other): raw(other.raw) {
+            other.raw.invoke = nullptr;
+            other.raw.destroy = nullptr;
+        }
+
+        ~function_wrapper() {
+            reset();
+        }
+
+        void operator()() { raw.invoke(&raw.storage); }
 
-        void operator()() { impl->call(); }
         function_wrapper& operator=(function_wrapper&& other) {
-            impl=std::move(other.impl);
+            if(this != &other) {
+                reset();
+                raw = other.raw;
+                other.raw.invoke = nullptr;
+                other.raw.destroy = nullptr;
+            }
             return *this;
         }
 
+        //! gives up ownership of the stored callable, used to pass tasks through lock-free queues
+        raw_type release() {
+            auto ret = raw;
+            raw.invoke = nullptr;
+            raw.destroy = nullptr;
+            return ret;
+        }
+
+        //! takes ownership of a callable given up by release
+        static function_wrapper adopt(const raw_type& released) {
+            function_wrapper ret;
+            ret.raw = released;
+            return ret;
+        }
+
         function_wrapper(const function_wrapper&)=delete;
         function_wrapper(function_wrapper&)=delete;
         function_wrapper& operator=(const function_wrapper&)=delete;
+
+    private:
+        raw_type raw;
+
+        template<typename functor, typename F>
+        void store(F&& f, std::true_type) {
+            new (&raw.storage) functor(std::forward<F>(f));
+            raw.invoke = &invoke_inline<functor>;
+            raw.destroy = has_abandon<functor>::value ? &abandon_inline<functor> : nullptr;
+        }
+
+        template<typename functor, typename F>
+        void store(F&& f, std::false_type) {
+            new (&raw.storage) functor*(new functor(std::forward<F>(f)));
+            raw.invoke = &invoke_heap<functor>;
+            raw.destroy = &destroy_heap<functor>;
+        }
+
+        void reset() {
+            if(raw.destroy) {
+                raw.destroy(&raw.storage);
+            }
+            raw.invoke = nullptr;
+            raw.destroy = nullptr;
+        }
+
+        template<typename functor>
+        static void invoke_inline(void* storage) {
+            (*static_cast<functor*>(storage))();
+        }
+
+        template<typename functor>
+        static void invoke_heap(void* storage) {
+            (**static_cast<functor**>(storage))();
+        }
+
+        template<typename functor>
+        static void destroy_heap(void* storage) {
+            auto f = *static_cast<functor**>(storage);
+            abandon(*f, 0);
+            delete f;
+        }
+
+        //! trivially copyable callables need no destruction, only abandon
+        template<typename functor>
+        static void abandon_inline(void* storage) {
+            abandon(*static_cast<functor*>(storage), 0);
+        }
+
+        template<typename functor>
+        static auto abandon(functor& f, int) -> decltype(f.abandon()) {
+            f.abandon();
+        }
+
+        template<typename functor>
+        static void abandon(functor&, long) {}
     };
 
 
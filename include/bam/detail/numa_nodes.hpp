@@ -0,0 +1,90 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// numa nodes of the cpus, from libnuma if BAM_USE_LIBNUMA is defined and from sysfs otherwise
+
+#ifndef BAM_NUMA_NODES_HPP
+#define BAM_NUMA_NODES_HPP
+
+#include "available_cpus.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#ifdef BAM_USE_LIBNUMA
+#include <numa.h>
+#endif
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace bam { namespace detail {
+
+    /**
+     * @brief node of every cpu, indexed by cpu number; cpus without a known node are on node 0
+     */
+    inline const std::vector<int>& cpu_nodes() {
+        static const std::vector<int> nodes = [] {
+            std::vector<int> nodes;
+            auto assign = [&] (int cpu, int node) {
+                if(cpu >= static_cast<int>(nodes.size())) {
+                    nodes.resize(cpu + 1, 0);
+                }
+                nodes[cpu] = node;
+            };
+
+#ifdef BAM_USE_LIBNUMA
+            if(numa_available() >= 0) {
+                for(int cpu = 0; cpu != numa_num_configured_cpus(); ++cpu) {
+                    assign(cpu, std::max(numa_node_of_cpu(cpu), 0));
+                }
+                return nodes;
+            }
+#endif
+            for(auto node : parse_cpu_list(read_file("/sys/devices/system/node/online"))) {
+                for(auto cpu : parse_cpu_list(read_file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist"))) {
+                    assign(cpu, node);
+                }
+            }
+            return nodes;
+        }();
+        return nodes;
+    }
+
+    inline int node_of_cpu(int cpu) {
+        auto& nodes = cpu_nodes();
+        return cpu >= 0 && cpu < static_cast<int>(nodes.size()) ? nodes[cpu] : 0;
+    }
+
+    /**
+     * @brief number of nodes with cpus, 1 on machines without numa
+     */
+    inline int numa_node_count() {
+        static const int count = [] {
+            auto nodes = cpu_nodes();
+            std::sort(nodes.begin(), nodes.end());
+            return std::max(static_cast<int>(std::unique(nodes.begin(), nodes.end()) - nodes.begin()), 1);
+        }();
+        return count;
+    }
+
+    /**
+     * @brief node of the cpu the calling thread currently runs on, -1 if unknown
+     */
+    inline int current_numa_node() {
+#ifdef __linux__
+        if(numa_node_count() > 1) {
+            auto cpu = sched_getcpu();
+            return cpu < 0 ? -1 : node_of_cpu(cpu);
+        }
+        return 0;
+#else
+        return -1;
+#endif
+    }
+} }
+
+#endif // BAM_NUMA_NODES_HPP
@@ -5,11 +5,25 @@
 #ifndef BAM_PARALLEL_UTILITY_HPP
 #define BAM_PARALLEL_UTILITY_HPP
 
+#include "../aggregate_exception.hpp"
+#include "../cancellation.hpp"
+#include "cache_line.hpp"
+#include "cache_sizes.hpp"
+#include "fixed_vector.hpp"
+#include "numa_nodes.hpp"
+#include "sequential_cutoff.hpp"
 #include "work_range.hpp"
+#include "worker_pool.hpp"
 #include <thread>
 #include <vector>
-#include <list>
-#include <future>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
 #include <iostream>
 
 namespace bam { namespace detail {
@@ -36,24 +50,80 @@ namespace bam { namespace detail {
     }
 
     /**
-     * @brief get_threadcount checks hardware concurrency
-     * @return returns number threads to be used
+     * @brief elements a parallel_ construct iterates over and whether they lie in memory; integer ranges
+     * iterate over the integers
+     */
+    template<typename ra_iter, bool = std::is_integral<ra_iter>::value>
+    struct range_element {
+        typedef typename std::iterator_traits<ra_iter>::value_type type;
+        typedef std::is_lvalue_reference<typename std::iterator_traits<ra_iter>::reference> in_memory;
+    };
+
+    template<typename ra_iter>
+    struct range_element<ra_iter, true> {
+        typedef ra_iter type;
+        typedef std::false_type in_memory;
+    };
+
+    /**
+     * @brief smallest number of elements of type T which fill whole cache lines
+     */
+    template<typename T>
+    std::size_t elements_per_cache_line() {
+        auto lowest_bit = sizeof(T) & (~sizeof(T) + 1); // cache_line_size is a power of two
+        return cache_line_size / std::min(lowest_bit, cache_line_size);
+    }
+
+    /**
+     * \brief adapts a grainsize to the element size: a chunk should fill the L1 cache, but fit into the L2
+     * cache together with what it writes, and cover whole cache lines
+     * \param grainsize grainsize picked by the element count
+     * \param work_per_thread size of the initial work of one thread, keeps enough chunks to steal
+     * \param caches cache sizes of the cores
+     */
+    template<typename value_type, typename distance>
+    int fit_to_caches(int grainsize, distance work_per_thread, const cache_sizes& caches) {
+        typedef long long count;
+        auto fill_l1 = std::min(static_cast<count>(caches.l1d / 2 / sizeof(value_type)), static_cast<count>(work_per_thread / 4));
+        auto fit_l2 = std::max(static_cast<count>(caches.l2 / 2 / sizeof(value_type)), count(1));
+        auto chunk = std::min(std::max(static_cast<count>(grainsize), fill_l1), fit_l2);
+
+        auto line = static_cast<count>(elements_per_cache_line<value_type>());
+        if(chunk >= line) {
+            chunk -= chunk % line;
+        }
+        return static_cast<int>(chunk);
+    }
+
+    /**
+     * \brief grainsize for a range of value_type elements, taking number threads, range size and cache sizes into account
+     */
+    template<typename value_type, typename distance>
+    int get_cache_aware_grainsize(distance range_size, int threadcount) {
+        auto grainsize = get_grainsize(range_size, threadcount);
+        if(grainsize == 0) {
+            return 0;
+        }
+        return fit_to_caches<value_type>(grainsize, range_size / threadcount, get_cache_sizes());
+    }
+
+    /**
+     * @brief get_threadcount checks the concurrency limit
+     * @return returns number of pieces the range is split into
      */
     inline int get_threadcount() {
-        int physicalthreads = std::thread::hardware_concurrency();
-        int threadcount =  physicalthreads ? physicalthreads * 2 : 16; // small oversubscription
+        int threadcount = concurrency_limit() * 2; // small oversubscription
 
         return threadcount;
     }
 
     /**
-     * @brief get_threadcount checks hardware concurrency
+     * @brief get_threadcount checks the concurrency limit
      * \param rangesize range size to be worked on, to check whether there aren't too many threads
      */
     template<typename distance>
     int get_threadcount(distance rangesize) {
-        int physicalthreads = std::thread::hardware_concurrency();
-        int threadcount =  physicalthreads ? physicalthreads * 2 : 16; // small oversubscription
+        int threadcount = concurrency_limit() * 2; // small oversubscription
 
         if(threadcount > rangesize) {
             return rangesize;
@@ -64,14 +134,15 @@ namespace bam { namespace detail {
 
     /**
      * @brief returns grainsize, work_piece_per_thread
+     * @param grainsize grainsize asked for by the caller, taken as it is; 0 picks one fitting the caches
      */
-    template<typename distance>
+    template<typename value_type, typename distance>
     std::tuple<int, int> get_scheduler_params(distance dist, int grainsize) {
         // get all the parameters like threadcount, grainsize and work per thread
         auto threadcount = detail::get_threadcount(dist);
 
         if(grainsize == 0) {
-            grainsize = detail::get_grainsize(dist, threadcount);
+            grainsize = detail::get_cache_aware_grainsize<value_type>(dist, threadcount);
         }
         auto work_piece_per_thread = threadcount ? dist / threadcount : 0;
 
@@ -79,31 +150,311 @@ namespace bam { namespace detail {
     }
 
     /**
-     * @brief builds work with given range and work per thread
+     * @brief number of pieces a parallel_ call keeps its per piece state for on the stack
+     *
+     * get_threadcount() cuts a range into two pieces per thread, so calls on machines with up to 64 threads
+     * never allocate. Calls cutting more pieces reserve their state on the heap, once per call.
+     */
+    static const std::size_t inline_piece_count = 2 * 64;
+
+    //! stack bytes one container of per piece state may take, larger elements get fewer inline pieces
+    static const std::size_t inline_state_size = 8192;
+
+    /**
+     * @brief inline capacity of a fixed_vector holding per piece state of type T
+     */
+    template<typename T>
+    constexpr std::size_t inline_piece_capacity() {
+        return sizeof(T) * inline_piece_count <= inline_state_size ? inline_piece_count
+             : sizeof(T) < inline_state_size ? inline_state_size / sizeof(T) : 1;
+    }
+
+    //! fixed_vector for per piece state, kept on the stack up to inline_piece_capacity elements
+    template<typename T>
+    using piece_vector = fixed_vector<T, inline_piece_capacity<T>()>;
+
+    /**
+     * @brief the work_ranges of one parallel_ call
+     */
+    template<typename range_iter>
+    class work_ranges : public piece_vector<work_range<range_iter>> {
+    public:
+        weighted_slicer slicer; // hands out the initial slices if the cores differ in speed
+    };
+
+    /**
+     * @brief number of elements in front of the first one starting on a cache line, 0 if the iterator doesn't
+     * refer to elements in memory or none starts on one
+     */
+    template<typename ra_iter>
+    std::size_t elements_before_cache_line(ra_iter it, std::true_type) {
+        typedef typename range_element<ra_iter>::type value_type;
+        auto address = reinterpret_cast<std::uintptr_t>(std::addressof(*it));
+        for(auto i = 0u; i != elements_per_cache_line<value_type>(); ++i) {
+            if((address + i * sizeof(value_type)) % cache_line_size == 0) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+    template<typename ra_iter>
+    std::size_t elements_before_cache_line(ra_iter, std::false_type) {
+        return 0;
+    }
+
+    template<typename ra_iter>
+    std::size_t elements_before_cache_line(ra_iter it) {
+        return elements_before_cache_line(it, typename range_element<ra_iter>::in_memory());
+    }
+
+    /**
+     * @brief builds work with given range and work per thread; if the cores differ in speed, each range
+     * instead takes a slice sized by the speed of the thread running it, once it starts
+     * @param work empty container to be filled with the work_ranges
+     * @param align_chunks whether all chunks but the first start on a cache line, such that workers writing
+     * neighbouring chunks don't share one
      */
     template<typename range_iter>
-    std::list<work_range<range_iter>> make_work(range_iter begin, range_iter end, int initial_work_per_thread, int grainsize) {
-        std::list<work_range<range_iter>> work;
-        
-        auto counter = begin;
-        for(; counter < end - initial_work_per_thread; counter += initial_work_per_thread) {
-            work.emplace_back(counter, counter + initial_work_per_thread, grainsize);
+    void make_work(work_ranges<range_iter>& work, range_iter begin, range_iter end, int initial_work_per_thread, int grainsize,
+                   claim_policy policy = claim_policy::fixed, bool align_chunks = false) {
+        typedef typename work_range<range_iter>::difference_type difference_type;
+
+        // work_ranges count chunks in 32 bits, coarsen the grain for gigantic ranges
+        auto size = end - begin;
+        auto chunk_size = std::max(static_cast<difference_type>(grainsize), static_cast<difference_type>(size >> 31) + 1);
+        auto head = align_chunks && size > 0 ? static_cast<difference_type>(elements_before_cache_line(begin)) : 0;
+        std::uint32_t skew = head > 0 && head < chunk_size ? chunk_size - head : 0;
+        std::uint32_t chunk_count = (size + skew + chunk_size - 1) / chunk_size;
+        std::uint32_t chunks_per_range = std::max(static_cast<difference_type>(initial_work_per_thread) / chunk_size, static_cast<difference_type>(1));
+        std::uint32_t range_count = std::max((chunk_count + chunks_per_range - 1) / chunks_per_range, 1u);
+        work.reserve(range_count);
+
+        auto mean = mean_capacity();
+        if(mean > 0 && range_count > 1) {
+            work.slicer.reset(chunk_count, range_count, mean);
+            for(auto i = 0u; i != range_count; ++i) {
+                work.emplace_back(begin, size, chunk_size, 0, 0, policy, &work.slicer, skew);
+            }
+            return;
+        }
+
+        std::uint32_t first = 0;
+        for(; first + chunks_per_range < chunk_count; first += chunks_per_range) {
+            work.emplace_back(begin, size, chunk_size, first, first + chunks_per_range, policy, nullptr, skew);
+        }
+        work.emplace_back(begin, size, chunk_size, first, chunk_count, policy, nullptr, skew);
+    }
+
+    /**
+     * @brief holds either the return value or the exception of one task
+     */
+    template<typename R>
+    class task_result {
+    public:
+        task_result() : has_value(false) {}
+
+        ~task_result() {
+            if(has_value) {
+                value_ptr()->~R();
+            }
+        }
+
+        task_result(const task_result&) = delete;
+        task_result& operator=(const task_result&) = delete;
+
+        template<typename F, typename Arg>
+        void run(F& foo, Arg& arg) {
+            try {
+                new (&storage) R(foo(arg));
+                has_value = true;
+            } catch(...) {
+                error = std::current_exception();
+            }
+        }
+
+        std::exception_ptr get_exception() const {
+            return error;
+        }
+
+        //! returns the value or rethrows the exception
+        R get() {
+            if(error) {
+                std::rethrow_exception(error);
+            }
+            return std::move(*value_ptr());
+        }
+
+    private:
+        typename std::aligned_storage<sizeof(R), alignof(R)>::type storage;
+        bool has_value;
+        std::exception_ptr error;
+
+        R* value_ptr() {
+            return reinterpret_cast<R*>(&storage);
+        }
+    };
+
+    template<>
+    class task_result<void> {
+    public:
+        template<typename F, typename Arg>
+        void run(F& foo, Arg& arg) {
+            try {
+                foo(arg);
+            } catch(...) {
+                error = std::current_exception();
+            }
         }
-        work.emplace_back(counter, end, grainsize);
 
-        return work;
+        std::exception_ptr get_exception() const {
+            return error;
+        }
+
+        void get() {
+            if(error) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        std::exception_ptr error;
+    };
+
+    template<typename R>
+    using task_results = piece_vector<task_result<R>>;
+
+    /**
+     * @brief job running foo once on each element of the work
+     */
+    template<typename Work, typename worker_foo, typename Results>
+    class element_job : public job_base {
+    public:
+        element_job(Work& work_, const worker_foo& foo_, Results& results_)
+          : job_base(work_.size()), work(work_), foo(foo_), results(results_) {}
+
+        void execute(std::size_t index) {
+            worker_foo local_foo(foo); // every task gets its own copy like it used to with std::async
+            results[index].run(local_foo, work[index]);
+        }
+
+    private:
+        Work& work;
+        const worker_foo& foo;
+        Results& results;
+    };
+
+    /**
+     * @brief runs foo on every element of work on the persistent worker pool, the calling thread joins in
+     * @param results one task_result per element of work, get them with get_tasks
+     */
+    template<typename Work, typename worker_foo, typename Results>
+    void spawn_tasks(Work& work, worker_foo&& foo, Results& results) {
+        typedef typename std::decay<worker_foo>::type foo_type;
+
+        element_job<Work, foo_type, Results> job(work, foo, results);
+        get_worker_pool().run(job);
     }
 
-    template<typename Work, typename worker_foo>
-    auto spawn_tasks(Work& work, worker_foo&& foo) 
-      -> std::vector<std::future<typename std::result_of<worker_foo(typename Work::value_type&)>::type>>
-    {
-        std::vector<std::future<typename std::result_of<worker_foo(typename Work::value_type&)>::type>> threads;
-        for(auto&& w : work) {
-            threads.emplace_back(std::async(std::launch::async, foo, std::ref(w)));
+    /**
+     * @brief which slot ran each element of an affine_element_job and on which numa node
+     */
+    struct affinity_record {
+        std::vector<int> slots;
+        std::vector<int> nodes;
+    };
+
+    /**
+     * @brief like element_job, but every worker slot first picks the elements it ran during the previous
+     * call, such that the data they touch is likely still in its cache; then the ones which ran on its
+     * numa node, as their memory was most likely first touched there; the others are taken in order
+     */
+    template<typename Work, typename worker_foo, typename Results>
+    class affine_element_job : public job_base {
+    public:
+        /**
+         * @param previous_ record of the previous call, ignored if its size doesn't match
+         */
+        affine_element_job(Work& work_, const worker_foo& foo_, Results& results_, const affinity_record& previous_)
+          : job_base(work_.size()), work(work_), foo(foo_), results(results_), previous(previous_), taken(work_.size()),
+            next_slots(work_.size()), next_nodes(work_.size()) {
+            for(auto& t : taken) {
+                t.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        void execute(std::size_t) {
+            // every step picks one element, count steps are claimed in total, so each element runs once
+            auto slot = worker_pool::current_slot();
+            auto node = current_numa_node();
+            auto index = claim(slot, node);
+            next_slots[index] = slot;
+            next_nodes[index] = node;
+
+            worker_foo local_foo(foo);
+            results[index].run(local_foo, work[index]);
+        }
+
+        //! slot which ran each element, valid once the job finished
+        const piece_vector<int>& slots() const {
+            return next_slots;
         }
 
-        return threads;
+        //! numa node each element ran on, -1 if unknown, valid once the job finished
+        const piece_vector<int>& nodes() const {
+            return next_nodes;
+        }
+
+    private:
+        Work& work;
+        const worker_foo& foo;
+        Results& results;
+        const affinity_record& previous;
+        piece_vector<std::atomic<bool>> taken;
+        piece_vector<int> next_slots;
+        piece_vector<int> next_nodes;
+
+        bool try_take(std::size_t index) {
+            return !taken[index].load(std::memory_order_relaxed) && !taken[index].exchange(true);
+        }
+
+        std::size_t claim(int slot, int node) {
+            if(previous.slots.size() == work.size()) {
+                for(auto i = 0u; i != work.size(); ++i) {
+                    if(previous.slots[i] == slot && try_take(i)) {
+                        return i;
+                    }
+                }
+            }
+
+            if(node >= 0 && previous.nodes.size() == work.size() && numa_node_count() > 1) {
+                for(auto i = 0u; i != work.size(); ++i) {
+                    if(previous.nodes[i] == node && try_take(i)) {
+                        return i;
+                    }
+                }
+            }
+
+            for(auto i = 0u; ; ++i) {
+                if(try_take(i)) {
+                    return i;
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief spawn_tasks which replays the element to worker mapping of a previous call
+     * @param record slots and nodes which ran each element during the previous call, updated for this call
+     */
+    template<typename Work, typename worker_foo, typename Results>
+    void spawn_affine_tasks(Work& work, worker_foo&& foo, Results& results, affinity_record& record) {
+        typedef typename std::decay<worker_foo>::type foo_type;
+
+        affine_element_job<Work, foo_type, Results> job(work, foo, results, record);
+        get_worker_pool().run(job);
+        record.slots.assign(job.slots().begin(), job.slots().end());
+        record.nodes.assign(job.nodes().begin(), job.nodes().end());
     }
 
     template<typename Tasks>
@@ -113,6 +464,85 @@ namespace bam { namespace detail {
         }
     }
 
+    /**
+     * @brief stops the chunks of one parallel_ call which haven't started yet, once its token is cancelled
+     * or one of its chunks threw
+     */
+    class stop_state {
+    public:
+        /**
+         * @param collect_ whether exceptions are wrapped into an aggregate_exception, such that they can be
+         * collected from all tasks
+         */
+        stop_state(const cancellation_token& token_, bool collect_) : token(token_), collect(collect_), failed(false) {}
+
+        stop_state(const stop_state&) = delete;
+        stop_state& operator=(const stop_state&) = delete;
+
+        bool stop_requested() const {
+            return failed.load(std::memory_order_relaxed) || token.is_cancelled();
+        }
+
+        //! runs foo, e.g. on one chunk, and stops the other chunks if it throws
+        template<typename F, typename ...Args>
+        auto run(F& foo, Args&& ...args) -> decltype(foo(std::forward<Args>(args)...)) {
+            try {
+                return foo(std::forward<Args>(args)...);
+            }
+            catch(const aggregate_exception&) { // of a nested call, merged by rethrow_errors
+                failed.store(true, std::memory_order_relaxed);
+                throw;
+            }
+            catch(...) {
+                failed.store(true, std::memory_order_relaxed);
+                if(collect) {
+                    throw aggregate_exception(std::vector<std::exception_ptr>(1, std::current_exception()));
+                }
+                throw;
+            }
+        }
+
+        /**
+         * @brief rethrows the exception of the first task which failed, or all of them in one
+         * aggregate_exception if they are collected; then throws operation_cancelled if the token was cancelled
+         */
+        template<typename Tasks>
+        void rethrow_errors(Tasks& tasks) const {
+            std::vector<std::exception_ptr> errors;
+            for(auto&& task : tasks) {
+                auto error = task.get_exception();
+                if(!error) {
+                    continue;
+                }
+                if(!collect) {
+                    std::rethrow_exception(error);
+                }
+                try {
+                    std::rethrow_exception(error);
+                }
+                catch(const aggregate_exception& aggregate) {
+                    errors.insert(errors.end(), aggregate.exceptions().begin(), aggregate.exceptions().end());
+                }
+                catch(...) {
+                    errors.push_back(error);
+                }
+            }
+            if(!errors.empty()) {
+                throw aggregate_exception(std::move(errors));
+            }
+            token.throw_if_cancelled();
+        }
+
+        const cancellation_token& get_token() const {
+            return token;
+        }
+
+    private:
+        const cancellation_token& token;
+        const bool collect;
+        std::atomic<bool> failed; // set by the first chunk which threw
+    };
+
 } }
 
 #endif // UTILITY_HPP
@@ -0,0 +1,343 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// decides whether a parallel_ call is worth dispatching to the worker pool at all
+
+#ifndef BAM_SEQUENTIAL_CUTOFF_HPP
+#define BAM_SEQUENTIAL_CUTOFF_HPP
+
+#include "../cancellation.hpp"
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bam { namespace detail {
+
+    /**
+     * @brief job without any work, used to measure what running a job on the worker pool costs
+     */
+    class empty_job : public job_base {
+    public:
+        explicit empty_job(std::size_t count) : job_base(count) {}
+
+        void execute(std::size_t) {}
+    };
+
+    /**
+     * @brief median time of running an empty job on all workers, measured once
+     * @return nanoseconds, infinity if there are no workers such that every call runs on the caller
+     */
+    inline double dispatch_overhead_ns() {
+        static const double overhead = [] {
+            auto& pool = get_worker_pool();
+            if(pool.size() == 0) {
+                return std::numeric_limits<double>::infinity();
+            }
+
+            std::array<double, 9> samples;
+            for(auto& sample : samples) {
+                empty_job job(pool.size() + 1);
+                auto start = std::chrono::steady_clock::now();
+                pool.run(job);
+                sample = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            }
+            std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+            return samples[samples.size() / 2];
+        }();
+        return overhead;
+    }
+
+    //! lower bound of the cutoff, the calibration can't see workers which first have to wake up
+    static const double min_sequential_cutoff_ns = 5000;
+
+    /**
+     * @brief work below this many nanoseconds runs faster on the calling thread than on the pool
+     */
+    inline double sequential_cutoff_ns() {
+        return std::max(2 * dispatch_overhead_ns(), min_sequential_cutoff_ns);
+    }
+
+    /**
+     * @brief calls run on [first, last) in chunks of exactly grainsize, the last one may be shorter; on all of it
+     * at once without a grainsize
+     */
+    template<typename ra_iter, typename Run>
+    void run_chunks(Run& run, ra_iter first, ra_iter last, int grainsize) {
+        if(grainsize <= 0) {
+            run(first, last);
+            return;
+        }
+        while(first < last) {
+            auto next = first + std::min(static_cast<decltype(last - first)>(grainsize), last - first);
+            run(first, next);
+            first = next;
+        }
+    }
+
+    /**
+     * @brief cutoff in nanoseconds, infinity if nobody could share the work, e.g. after bam::set_max_concurrency(1)
+     */
+    inline double current_cutoff_ns() {
+        return get_worker_pool().active_size() == 0 ? std::numeric_limits<double>::infinity() : sequential_cutoff_ns();
+    }
+
+    /**
+     * @brief decides with the cost hint, or without workers, whether [begin, end) runs right here, and runs it if so
+     * @return true if the decision was made, then has_run tells which one
+     */
+    template<typename ra_iter, typename Run>
+    bool decide_up_front(ra_iter& begin, ra_iter end, Run& run, std::chrono::nanoseconds cost_hint, int grainsize,
+                         double cutoff, bool& has_run) {
+        if(cost_hint.count() <= 0 && cutoff != std::numeric_limits<double>::infinity()) {
+            return false;
+        }
+        has_run = static_cast<double>(cost_hint.count()) * (end - begin) < cutoff;
+        if(has_run) {
+            run_chunks(run, begin, end, grainsize);
+            begin = end;
+        }
+        return true;
+    }
+
+    /**
+     * @brief runs the front of [begin, end) on the calling thread and decides whether the rest is worth
+     * dispatching to the worker pool
+     *
+     * With a cost hint the decision is made up front. Without one, pieces of 1, 2, 4, ... elements are run
+     * and timed until either the estimated total is below the cutoff, in which case everything is run here,
+     * or a quarter of the cutoff was spent, in which case the rest is dispatched at once. The pieces are run
+     * one after another, as run may depend on everything in front of them, so the first element is always
+     * paid for before the rest is dispatched; see run_or_dispatch for bodies which don't.
+     * @param begin begin of the range, advanced past everything run here
+     * @param run callable taking a pair of iterators, runs the body of the algorithm on them
+     * @param cost_hint estimated time per element, zero if unknown
+     * @param grainsize grainsize asked for by the caller, 0 if none; if given, pieces are multiples of it and
+     * run is called on chunks of exactly that size, such that the rest starts on the chunk grid
+     * @return true if the whole range has been run, false if [begin, end) is left for the pool
+     */
+    template<typename ra_iter, typename Run>
+    bool run_below_cutoff(ra_iter& begin, ra_iter end, Run&& run, std::chrono::nanoseconds cost_hint, int grainsize = 0) {
+        typedef decltype(end - begin) difference_type;
+
+        if(!(begin < end)) {
+            return true;
+        }
+
+        auto cutoff = current_cutoff_ns();
+        bool has_run = false;
+        if(decide_up_front(begin, end, run, cost_hint, grainsize, cutoff, has_run)) {
+            return has_run;
+        }
+
+        difference_type done = 0;
+        difference_type piece = std::max(grainsize, 1);
+        double elapsed = 0;
+        while(true) {
+            auto next = begin + std::min(piece, end - begin);
+            auto start = std::chrono::steady_clock::now();
+            run_chunks(run, begin, next, grainsize);
+            elapsed += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            done += next - begin;
+            begin = next;
+
+            if(begin == end) {
+                return true;
+            }
+            if(elapsed / done * (end - begin) < cutoff - elapsed) {
+                run_chunks(run, begin, end, grainsize);
+                begin = end;
+                return true;
+            }
+            if(elapsed * 4 >= cutoff) {
+                return false;
+            }
+            piece *= 2;
+        }
+    }
+
+    //! exception of one piece of a probe_job, in the shape stop_state::rethrow_errors takes
+    struct probe_error {
+        std::exception_ptr error;
+
+        std::exception_ptr get_exception() const {
+            return error;
+        }
+    };
+
+    /**
+     * @brief job of run_or_dispatch: the calling thread probes the front of the range like run_below_cutoff
+     * does, while the workers run it from the back in growing pieces of whole units, chunks or elements
+     */
+    template<typename ra_iter, typename Run, typename Dispatch>
+    class probe_job : public job_base {
+    public:
+        typedef decltype(std::declval<ra_iter>() - std::declval<ra_iter>()) difference_type;
+
+        probe_job(std::size_t count, ra_iter begin_, ra_iter end_, Run& run_, Dispatch& dispatch_, int grainsize_, double cutoff_)
+          : job_base(count), begin(begin_), size(end_ - begin_), unit(std::max(grainsize_, 1)), run(run_), dispatch(dispatch_),
+            grainsize(grainsize_), cutoff(cutoff_), caller(std::this_thread::get_id()), front(0),
+            back((size + unit - 1) / unit), closed(false), probed(false) {}
+
+        void execute(std::size_t) {
+            try {
+                if(std::this_thread::get_id() != caller) {
+                    run_back();
+                }
+                else if(!probed) {
+                    probed = true;
+                    probe();
+                }
+            }
+            catch(const operation_cancelled&) { // of dispatch, thrown again by rethrow_errors as the token stays cancelled
+                close();
+            }
+            catch(...) {
+                std::lock_guard<std::mutex> lock(m);
+                errors_.push_back(probe_error{ std::current_exception() });
+                closed = true;
+            }
+        }
+
+        //! what run and dispatch threw, valid once the job finished; only allocates if something was thrown
+        const std::vector<probe_error>& errors() const {
+            return errors_;
+        }
+
+    private:
+        const ra_iter begin;
+        const difference_type size;
+        const difference_type unit;
+        Run& run;
+        Dispatch& dispatch;
+        const int grainsize;
+        const double cutoff;
+        const std::thread::id caller;
+        std::mutex m;
+        difference_type front; // units [front, back) are left, guarded by m
+        difference_type back;
+        bool closed;           // set once the rest is dispatched, guarded by m
+        bool probed;           // only touched by the caller
+        std::vector<probe_error> errors_;
+
+        void close() {
+            std::lock_guard<std::mutex> lock(m);
+            closed = true;
+        }
+
+        ra_iter position(difference_type units) const {
+            return begin + std::min(units * unit, size);
+        }
+
+        void run_back() {
+            Run local_run(run); // every worker gets its own copy of the body, like the tasks of the pool
+            difference_type piece = 1;
+            while(true) {
+                difference_type first, last;
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    if(closed || front >= back) {
+                        return;
+                    }
+                    last = back;
+                    first = back = std::max(front, back - piece);
+                }
+                auto start = std::chrono::steady_clock::now();
+                run_chunks(local_run, position(first), position(last), grainsize);
+
+                // pieces of cheap units grow like the ones of the probe, expensive units are taken one at a time
+                auto unit_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (last - first);
+                piece = unit_ns * 4 < cutoff ? piece * 2 : 1;
+            }
+        }
+
+        void probe() {
+            difference_type done = 0;
+            difference_type piece = 1;
+            double elapsed = 0;
+            while(true) {
+                difference_type first, last;
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    if(closed || front >= back) {
+                        return;
+                    }
+                    first = front;
+                    last = front = std::min(front + piece, back);
+                }
+                auto start = std::chrono::steady_clock::now();
+                run_chunks(run, position(first), position(last), grainsize);
+                elapsed += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+                done += position(last) - position(first);
+
+                std::unique_lock<std::mutex> lock(m);
+                if(closed || front >= back) {
+                    return;
+                }
+                first = front;
+                last = back;
+                if(elapsed / done * (position(last) - position(first)) < cutoff - elapsed) {
+                    front = back;
+                    lock.unlock();
+                    run_chunks(run, position(first), position(last), grainsize);
+                    return;
+                }
+                if(elapsed * 4 >= cutoff) {
+                    // workers still busy with a piece of the back join the dispatched job once they are done
+                    closed = true;
+                    lock.unlock();
+                    dispatch(position(first), position(last));
+                    return;
+                }
+                piece *= 2;
+            }
+        }
+    };
+
+    /**
+     * @brief run_below_cutoff for bodies which may run the pieces of the range in any order, e.g. the one of
+     * parallel_for: without a cost hint the workers run the back of the range while the calling thread probes
+     * the front, such that an expensive first element doesn't hold up the others. What the probe finds worth
+     * dispatching is handed to dispatch right away, which the workers join once they are done with their piece.
+     * @param run callable taking a pair of iterators, runs the body of the algorithm on them, copied for each worker
+     * @param dispatch callable taking a pair of iterators, runs the body on them on the worker pool
+     * @param stop stop_state of the call, rethrows what the pieces run during the probe threw
+     * @param cost_hint estimated time per element, zero if unknown
+     * @param grainsize grainsize asked for by the caller, 0 if none; run is only called on whole chunks of its grid
+     */
+    template<typename ra_iter, typename Run, typename Dispatch, typename Stop>
+    void run_or_dispatch(ra_iter begin, ra_iter end, Run&& run, Dispatch&& dispatch, const Stop& stop,
+                         std::chrono::nanoseconds cost_hint, int grainsize = 0) {
+        if(!(begin < end)) {
+            return;
+        }
+
+        auto cutoff = current_cutoff_ns();
+        bool has_run = false;
+        if(decide_up_front(begin, end, run, cost_hint, grainsize, cutoff, has_run)) {
+            if(!has_run) {
+                dispatch(begin, end);
+            }
+            return;
+        }
+
+        auto& pool = get_worker_pool();
+        typedef typename std::remove_reference<Run>::type run_type;
+        typedef typename std::remove_reference<Dispatch>::type dispatch_type;
+        probe_job<ra_iter, run_type, dispatch_type> job(pool.active_size() + 1, begin, end, run, dispatch, grainsize, cutoff);
+        pool.run(job);
+        stop.rethrow_errors(job.errors());
+    }
+} }
+
+#endif // BAM_SEQUENTIAL_CUTOFF_HPP
@@ -0,0 +1,205 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// cpu topology, decides where pinned workers run and in which order they steal
+
+#ifndef BAM_TOPOLOGY_HPP
+#define BAM_TOPOLOGY_HPP
+
+#include "available_cpus.hpp"
+#include "numa_nodes.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace bam { namespace detail {
+
+    /**
+     * @brief where a logical cpu sits; cpus with the same package and core are smt siblings
+     */
+    struct cpu_info {
+        int cpu;
+        int core;    //!< core id, unique within the package
+        int l3;      //!< lowest cpu sharing the last level cache with this one
+        int package;
+        int node;    //!< numa node, a package may be split into several
+    };
+
+    //! how far apart two cpus are, workers steal from closer ones first
+    enum class cpu_distance {
+        same_core,
+        same_l3,
+        same_node,
+        same_package, //!< but another numa node
+        remote
+    };
+
+    inline cpu_distance distance_between(const cpu_info& a, const cpu_info& b) {
+        if(a.package != b.package) {
+            return cpu_distance::remote;
+        }
+        if(a.node != b.node) {
+            return cpu_distance::same_package;
+        }
+        if(a.core == b.core) {
+            return cpu_distance::same_core;
+        }
+        return a.l3 == b.l3 ? cpu_distance::same_l3 : cpu_distance::same_node;
+    }
+
+    /**
+     * @brief order in which workers are placed: one cpu of every physical core first, then their smt
+     * siblings; cores sharing a cache and a package stay next to each other
+     */
+    inline std::vector<cpu_info> placement_order(std::vector<cpu_info> cpus) {
+        auto key = [] (const cpu_info& c) { return std::make_tuple(c.package, c.node, c.l3, c.core, c.cpu); };
+        std::sort(cpus.begin(), cpus.end(), [&] (const cpu_info& a, const cpu_info& b) { return key(a) < key(b); });
+
+        std::vector<cpu_info> order;
+        std::vector<cpu_info> siblings;
+        for(auto it = cpus.begin(); it != cpus.end(); ++it) {
+            bool first_of_core = it == cpus.begin() || distance_between(*(it - 1), *it) != cpu_distance::same_core;
+            (first_of_core ? order : siblings).push_back(*it);
+        }
+        order.insert(order.end(), siblings.begin(), siblings.end());
+        return order;
+    }
+
+    /**
+     * @brief victims grouped by their distance to the thief, closest group first
+     * @param cpus cpu of every worker, indexed like the steal pool
+     * @param thief index of the stealing worker, left out
+     */
+    inline std::vector<std::vector<std::size_t>> steal_levels(const std::vector<cpu_info>& cpus, std::size_t thief) {
+        std::vector<std::vector<std::size_t>> levels(static_cast<int>(cpu_distance::remote) + 1);
+        for(auto victim = 0u; victim != cpus.size(); ++victim) {
+            if(victim != thief) {
+                levels[static_cast<int>(distance_between(cpus[thief], cpus[victim]))].push_back(victim);
+            }
+        }
+        levels.erase(std::remove_if(levels.begin(), levels.end(), [] (const std::vector<std::size_t>& l) { return l.empty(); }), levels.end());
+        return levels;
+    }
+
+#ifdef __linux__
+    //! cpus the process may run on
+    inline std::vector<int> allowed_cpus() {
+        std::vector<int> cpus;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if(sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for(int cpu = 0; cpu != CPU_SETSIZE; ++cpu) {
+                if(CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        return cpus;
+    }
+
+    /**
+     * @brief reads the topology of cpu from /sys/devices/system/cpu, unknown parts make it look like its
+     * own core in package 0
+     */
+    inline cpu_info read_cpu_info(int cpu) {
+        auto dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        auto read_int = [&] (const std::string& file, int fallback) {
+            auto content = read_file(dir + file);
+            return content.empty() ? fallback : std::atoi(content.c_str());
+        };
+
+        cpu_info info;
+        info.cpu = cpu;
+        info.core = read_int("/topology/core_id", cpu);
+        info.package = read_int("/topology/physical_package_id", 0);
+        info.l3 = cpu;
+        info.node = node_of_cpu(cpu);
+        for(int index = 0; ; ++index) {
+            auto level = read_file(dir + "/cache/index" + std::to_string(index) + "/level");
+            if(level.empty()) {
+                break;
+            }
+            auto shared = parse_cpu_list(read_file(dir + "/cache/index" + std::to_string(index) + "/shared_cpu_list"));
+            if(std::atoi(level.c_str()) == 3 && !shared.empty()) {
+                info.l3 = shared.front();
+            }
+        }
+        return info;
+    }
+
+    //! pins the calling thread to cpu
+    inline void pin_current_thread(int cpu) {
+        if(cpu < 0 || cpu >= CPU_SETSIZE) {
+            return;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set); // best effort, an unpinned worker still works
+    }
+#else
+    inline std::vector<int> allowed_cpus() {
+        return std::vector<int>();
+    }
+
+    inline cpu_info read_cpu_info(int cpu) {
+        return cpu_info{ cpu, cpu, cpu, 0, 0 };
+    }
+
+    inline void pin_current_thread(int) {}
+#endif
+
+    /**
+     * @brief cpus of the process in placement order, read once
+     */
+    inline const std::vector<cpu_info>& get_topology() {
+        static const std::vector<cpu_info> topology = [] {
+            auto allowed = allowed_cpus();
+            if(allowed.empty()) {
+                int count = std::thread::hardware_concurrency();
+                for(int cpu = 0; cpu < std::max(count, 1); ++cpu) {
+                    allowed.push_back(cpu);
+                }
+            }
+
+            std::vector<cpu_info> cpus;
+            for(auto cpu : allowed) {
+                cpus.push_back(read_cpu_info(cpu));
+            }
+            return placement_order(cpus);
+        }();
+        return topology;
+    }
+
+    /**
+     * @brief cpu the index-th worker is pinned to; worker_pool slots and task_pool threads both count from
+     * 1, such that the first core is left to the thread which started them
+     */
+    inline const cpu_info& worker_cpu(std::size_t index) {
+        auto& topology = get_topology();
+        return topology[index % topology.size()];
+    }
+
+    //! set by bam::set_worker_pinning, defaults to the environment variable BAM_PIN_WORKERS
+    inline std::atomic<bool>& pin_workers_flag() {
+        static std::atomic<bool> pin(parse_concurrency(std::getenv("BAM_PIN_WORKERS")) != 0);
+        return pin;
+    }
+
+    inline bool pin_workers() {
+        return pin_workers_flag().load(std::memory_order_relaxed);
+    }
+} }
+
+#endif // BAM_TOPOLOGY_HPP
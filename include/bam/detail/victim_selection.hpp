@@ -0,0 +1,38 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// victim selection for work stealing in work_range and work_pool
+
+#ifndef BAM_VICTIM_SELECTION_HPP
+#define BAM_VICTIM_SELECTION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+namespace bam { namespace detail {
+
+    /**
+     * @brief cheap per thread xorshift generator, good enough to spread thieves
+     */
+    inline std::uint64_t next_random() {
+        static thread_local std::uint64_t state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ull;
+    }
+
+    /**
+     * @brief index of the first victim a thief looks at; thieves start at random positions and walk the pool
+     * from there, such that they don't all pile up on the first victim.
+     * @param victim_count size of the steal pool
+     */
+    inline std::size_t first_victim(std::size_t victim_count) {
+        return victim_count ? static_cast<std::size_t>(next_random() >> 32) % victim_count : 0;
+    }
+} }
+
+#endif // BAM_VICTIM_SELECTION_HPP
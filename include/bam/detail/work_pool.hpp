@@ -8,80 +8,142 @@
 #define BAM_WORK_POOL_HPP
 
 #include "function_wrapper.hpp"
+#include "chase_lev_deque.hpp"
+#include "victim_selection.hpp"
 
+#include <atomic>
+#include <cstddef>
 #include <mutex>
 #include <queue>
-#include <future>
 #include <vector>
 #include <utility>
 
 namespace bam { namespace detail {
 
+    /**
+     * @brief per worker task storage; tasks added by the owning worker go to a lock-free deque,
+     * tasks from any other thread go to a locked inbox
+     */
     class work_pool {
     public:
+        work_pool() : inbox_size(0) {}
+
+        ~work_pool() {
+            function_wrapper::raw_type task;
+            while(deque.pop(task)) {
+                function_wrapper::adopt(task);
+            }
+        }
+
+        work_pool(const work_pool&) = delete;
+        work_pool& operator=(const work_pool&) = delete;
 
         /**
-         * \brief add new task to pool
+         * \brief add new task to pool, only to be called by the worker owning this pool
+         * \param task callable function object which will be added to the deque
+         */
+        template<typename callable>
+        void push_local(callable&& task) {
+            function_wrapper wrapper(std::move(task));
+            auto raw = wrapper.release();
+            try {
+                deque.push(raw);
+            } catch(...) {
+                // the deque failed to grow, let the task be abandoned instead of leaking it
+                function_wrapper::adopt(raw);
+                throw;
+            }
+        }
+
+        /**
+         * \brief add new task to pool, may be called from any thread
          * \param task callable function object which will be added to queue
          */
         template<typename callable>
         void push_back(callable&& task) {
             std::lock_guard<std::mutex> lock(m);
-            queue.push(std::move(task));
+            inbox.push(std::move(task));
+            inbox_size.store(inbox.size(), std::memory_order_release);
         }
-  
+
         /**
-         * \brief try to add new task to pool
-         * \param task callable function object which will be added to queue
-         * \return false if queue is not empty, no task will be added in this case
+         * \brief adds a task only if the inbox is empty, checked and pushed under one lock; may be called from any thread
+         * \param make_task called under the lock only if the task is added, returns the function_wrapper to add
+         * \return true if the task was added
          */
-        template<typename callable>
-        bool try_push_back(callable&& task) {
+        template<typename task_maker>
+        bool try_push_back(task_maker&& make_task) {
             std::lock_guard<std::mutex> lock(m);
-    
-            if(queue.empty()) {
-                queue.push(std::move(task));
-                return true;
-            }
-            else {
+
+            if(!inbox.empty()) {
                 return false;
             }
+            inbox.push(make_task());
+            inbox_size.store(inbox.size(), std::memory_order_release);
+            return true;
         }
-  
+
         /**
-         * @brief try_fetch_work
+         * @brief try_fetch_work, only to be called by the worker owning this pool
          * @param ret function_wrapper which will be filled with new work if available
          * @param steal_pool std::vector of other work_pools from work can be stolen
          * @return true if work was fetched
          */
         bool try_fetch_work(function_wrapper& ret, std::vector<work_pool>& steal_pool) {
-            std::unique_lock<std::mutex> lock(m);
-            if(try_get_work(ret)) {
+            function_wrapper::raw_type task;
+            if(deque.pop(task)) {
+                ret = function_wrapper::adopt(task);
                 return true;
             }
-            else if(work_stealable(steal_pool, lock)) {
-                return try_get_work(ret);
+            else if(try_pop_inbox(ret)) {
+                return true;
             }
             else {
-                return false;
+                return work_stealable(ret, steal_pool, this);
             }
         }
-  
-  
+
+        /**
+         * @brief steals a task from any of the given pools, for threads which don't own a pool
+         * @param ret function_wrapper which will be filled with the stolen task
+         * @param steal_pool std::vector of work_pools from which work can be stolen
+         * @return true if work was stolen
+         */
+        static bool try_steal_work(function_wrapper& ret, std::vector<work_pool>& steal_pool) {
+            return work_stealable(ret, steal_pool, nullptr);
+        }
+
+        /**
+         * @brief makes the owner steal level by level, e.g. from workers on the same core before the ones
+         * on the same socket; to be set before the owner starts
+         * @param levels indices of the victims in the steal pool, closest group first
+         */
+        void set_steal_levels(std::vector<std::vector<std::size_t>> levels) {
+            steal_levels = std::move(levels);
+        }
 
     private:
+        chase_lev_deque<function_wrapper::raw_type> deque; // callables stored inline in the slots
         mutable std::mutex m;
-        std::queue<bam::detail::function_wrapper> queue;
+        std::queue<bam::detail::function_wrapper> inbox;
+        std::atomic<std::size_t> inbox_size; // written under m, lets pollers skip the lock of empty inboxes
+        std::vector<std::vector<std::size_t>> steal_levels; // empty unless workers are pinned
 
         /**
-         * @brief try_get_work try to get new work
+         * @brief takes the oldest task from the inbox
          * @param ret function_wrapper to be filled with next work
          * @return true if work was aquired
          */
-        bool try_get_work(function_wrapper& ret) { // take function_wrapper by ref for excep safety
-            if(!queue.empty()) {
-                ret = std::move(queue.front());
-                queue.pop();
+        bool try_pop_inbox(function_wrapper& ret) { // take function_wrapper by ref for excep safety
+            if(inbox_size.load(std::memory_order_acquire) == 0) {
+                return false;
+            }
+
+            std::lock_guard<std::mutex> lock(m);
+            if(!inbox.empty()) {
+                ret = std::move(inbox.front());
+                inbox.pop();
+                inbox_size.store(inbox.size(), std::memory_order_relaxed);
                 return true;
             }
             else {
@@ -90,41 +152,54 @@ namespace bam { namespace detail {
         }
 
         /**
-         * @brief work_stealable checks whether work can be stolen and steals if available
+         * @brief steals the oldest task of another pool, starting at a random victim; aborted steals
+         * are retried so that we only give up if every other pool was seen empty
+         * @param ret function_wrapper to be filled with the stolen task
          * @param steal_pool std::vector of other work_pools from which work can be stolen
-         * @param lock1 unqiue_lock which locks this->m
+         * @param thief pool of the stealing worker which is skipped, may be null
          * @return true if work was stolen
          */
-        bool work_stealable(std::vector<work_pool>& steal_pool, std::unique_lock<std::mutex>& lock1) {
-            for(auto& it : steal_pool) {
-                if(&it != this) {
-                    lock1.unlock();
-                    std::unique_lock<std::mutex> lock2(it.m, std::defer_lock);
-                    std::lock(lock1, lock2);
-
-                    const int queue_size = it.queue.size();
-                    auto remaining_work = 0;
-
-                    // we need to steal at least one function. This is needed for the semaphore signalling meachanism 
-                    if(queue_size == 1) {
-                        remaining_work = 1;
-                    }
-                    else {
-                        remaining_work = queue_size / 2;
-                    }
-
-                    if(remaining_work > 0) {
-                        while(remaining_work-- > 0) {
-                            queue.push(std::move(it.queue.front()));
-                            it.queue.pop();
+        static bool work_stealable(function_wrapper& ret, std::vector<work_pool>& steal_pool, const work_pool* thief) {
+            if(thief && !thief->steal_levels.empty()) {
+                // random victim within each level, such that neighbours don't all pile up on the same one
+                for(auto& level : thief->steal_levels) {
+                    auto start = first_victim(level.size());
+                    for(auto n = 0u; n != level.size(); ++n) {
+                        if(steal_pool[level[(start + n) % level.size()]].try_steal(ret)) {
+                            return true;
                         }
-
-                        return true;
                     }
                 }
+                return false;
+            }
+
+            auto start = first_victim(steal_pool.size());
+            for(auto n = 0u; n != steal_pool.size(); ++n) {
+                auto& it = steal_pool[(start + n) % steal_pool.size()];
+                if(&it != thief && it.try_steal(ret)) {
+                    return true;
+                }
             }
             return false;
         }
+
+        /**
+         * @brief takes the oldest task of the deque or else the inbox, called by threads not owning this pool
+         * @return true if work was stolen
+         */
+        bool try_steal(function_wrapper& ret) {
+            function_wrapper::raw_type task;
+            auto result = steal_result::abort;
+            while(result == steal_result::abort) {
+                result = deque.steal(task);
+            }
+
+            if(result == steal_result::success) {
+                ret = function_wrapper::adopt(task);
+                return true;
+            }
+            return try_pop_inbox(ret);
+        }
     };
 }}
 
@@ -7,30 +7,127 @@
 #ifndef BAM_WORK_RANGE_H
 #define BAM_WORK_RANGE_H
 
+#include "cache_line.hpp"
+#include "cpu_capacity.hpp"
+#include "numa_nodes.hpp"
+#include "victim_selection.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
 #include <utility>
-#include <mutex>
-#include <list>
-#include <memory>
 
 namespace bam { namespace detail {
 
+    /**
+     * @brief how the owner of a work_range claims its chunks
+     */
+    enum class claim_policy {
+        fixed,   //!< one chunk per claim
+        adaptive //!< claims double as long as no thief split the range, and start over at one chunk once one did
+    };
+
+    /**
+     * @brief hands out the initial slices of the work_ranges of one call on cpus with cores of different
+     * speed; every range takes its slice once its thread starts, sized by the capacity of that thread
+     */
+    class weighted_slicer {
+    public:
+        weighted_slicer() : state(0), total(0), mean(1) {}
+
+        weighted_slicer(const weighted_slicer&) = delete;
+        weighted_slicer& operator=(const weighted_slicer&) = delete;
+
+        /**
+         * @param chunk_count number of chunks to hand out
+         * @param range_count number of work_ranges which take a slice, the last one takes whatever is left
+         * @param mean_capacity average capacity of the threads, a thread of that capacity gets an even share
+         */
+        void reset(std::uint32_t chunk_count, std::uint32_t range_count, double mean_capacity) {
+            total = chunk_count;
+            mean = mean_capacity;
+            state.store((std::uint64_t(range_count) << 32), std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief slice of the next range, [first, last) chunk
+         * @param capacity capacity of the thread which runs the range
+         */
+        std::pair<std::uint32_t, std::uint32_t> claim(double capacity) {
+            auto current = state.load(std::memory_order_relaxed);
+            while(true) {
+                auto first = static_cast<std::uint32_t>(current);
+                auto ranges = static_cast<std::uint32_t>(current >> 32);
+                auto left = total - first;
+                auto share = std::ceil(left * capacity / (mean * std::max(ranges, 1u)));
+                auto count = ranges <= 1 ? left : static_cast<std::uint32_t>(std::min(share, static_cast<double>(left)));
+
+                auto next = (std::uint64_t(ranges ? ranges - 1 : 0) << 32) | (first + count);
+                if(state.compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+                    return std::make_pair(first, first + count);
+                }
+            }
+        }
+
+    private:
+        std::atomic<std::uint64_t> state; // ranges still to take a slice in the upper, next chunk in the lower half
+        std::uint32_t total;
+        double mean;
+    };
+
+    /**
+     * @brief a contiguous run of chunks of a range, chunk k covers [base + k * grainsize - skew, base + (k + 1) * grainsize - skew)
+     * clipped to the range; a skew makes the first chunk shorter, such that the others start on a cache line
+     *
+     * The unclaimed chunks [begin, end) are packed into one 64 bit word. The owner claims chunks from the front
+     * with a single fetch_add, thieves split off the back half with a CAS - no locks are involved.
+     * Every work_range gets a cache line of its own, such that claims on neighbouring ranges don't collide.
+     */
     template<typename ra_iter>
-    class work_range {
+    class alignas(cache_line_size) work_range {
     public:
-        work_range(ra_iter begin_, ra_iter end_, unsigned grainsize_) : iter(begin_), end(end_), grainsize(grainsize_)  {}
+        typedef decltype(std::declval<ra_iter>() - std::declval<ra_iter>()) difference_type;
+
+        /**
+         * @param base_ begin of the whole range which is worked on
+         * @param size_ size of the whole range
+         * @param grainsize_ size of one chunk
+         * @param first_chunk first chunk initially owned by this work_range
+         * @param last_chunk one past the last chunk initially owned by this work_range
+         * @param policy_ how many chunks the owner claims at once
+         * @param slicer_ if set, first_chunk and last_chunk are ignored and the range takes its chunks from slicer_
+         * once its owner starts
+         * @param skew_ elements missing from the first chunk, less than grainsize_
+         */
+        work_range(ra_iter base_, difference_type size_, difference_type grainsize_, std::uint32_t first_chunk, std::uint32_t last_chunk,
+                   claim_policy policy_ = claim_policy::fixed, weighted_slicer* slicer_ = nullptr, std::uint32_t skew_ = 0)
+          : base(base_), size(size_), grainsize(grainsize_), policy(policy_), skew(skew_), bounds(slicer_ ? 0 : pack(first_chunk, last_chunk)), batch(1),
+            seen_end(slicer_ ? 0 : last_chunk), node(unknown_node), slicer(slicer_) {}
 
         /**
          * @brief try_fetch_work tries to fetch work
          * @param chunk work chunk to fill with work
-         * @param steal_pool list of other work_ranges from which can be stolen if all work is done
+         * @param steal_pool contiguous container of all work_ranges, from which can be stolen if all work is done
          * @return true if work was aquired, false otherwise
          */
-        bool try_fetch_work(std::pair<ra_iter, ra_iter>& chunk, std::list<work_range<ra_iter>>& steal_pool) {
-            std::unique_lock<std::mutex> lock(m);
+        template<typename Pool>
+        bool try_fetch_work(std::pair<ra_iter, ra_iter>& chunk, Pool& steal_pool) {
+            if(node.load(std::memory_order_relaxed) == unknown_node) {
+                node.store(current_numa_node(), std::memory_order_relaxed);
+                if(slicer) {
+                    // nobody steals from an empty range, so a plain store is fine
+                    auto slice = slicer->claim(thread_capacity());
+                    bounds.store(pack(slice.first, slice.second), std::memory_order_relaxed);
+                    seen_end = slice.second;
+                }
+            }
+
             if (try_get_chunk(chunk)) {
                 return true;
             }
-            else if(work_stealable(steal_pool, lock)) {
+            else if(work_stealable(steal_pool)) {
                 return try_get_chunk(chunk);
             }
             else {
@@ -39,52 +136,97 @@ namespace bam { namespace detail {
         }
 
     private:
-        mutable std::mutex m;
-        ra_iter iter;
-        ra_iter end;
-        const int grainsize;
+        const ra_iter base;
+        const difference_type size;
+        const difference_type grainsize;
+        const claim_policy policy;
+        const std::uint32_t skew; // fills the gap behind policy, work_range has to stay within one cache line
+        std::atomic<std::uint64_t> bounds; // end chunk in the upper, begin chunk in the lower half
+        std::uint32_t batch; // chunks of the next adaptive claim, owner only
+        std::uint32_t seen_end; // end chunk at the last claim, a smaller end means a thief split the range, owner only
+        std::atomic<int> node; // numa node of the thread working on this range, written by the owner only
+        weighted_slicer* const slicer; // set if the range takes its slice only once its owner starts
+
+        static const int unknown_node = -2; // current_numa_node returns -1 if it can't tell
+
+        static std::uint64_t pack(std::uint32_t begin, std::uint32_t end) {
+            return (std::uint64_t(end) << 32) | begin;
+        }
+
+        static std::uint32_t begin_of(std::uint64_t packed) {
+            return static_cast<std::uint32_t>(packed);
+        }
+
+        static std::uint32_t end_of(std::uint64_t packed) {
+            return static_cast<std::uint32_t>(packed >> 32);
+        }
 
         /**
-         * @brief try_get_chunk trys to get work
+         * @brief try_get_chunk trys to claim the next chunks, only called by the owner
          * @param ret pair to fill with work
          * @return true if work was aquired
          */
         bool try_get_chunk(std::pair<ra_iter, ra_iter>& ret) { // take chunk by reference for excep safety
-            if(iter < end - grainsize) {
-                ret.first = iter;
-                ret.second = iter + grainsize;
-                iter += grainsize;
-                return true;
+            // don't keep bumping begin once we ran dry, that keeps it far away from overflowing
+            auto current = bounds.load(std::memory_order_relaxed);
+            if(begin_of(current) >= end_of(current)) {
+                return false;
             }
-            else if (iter < end) {
-                ret.first = iter;
-                ret.second = end;
-                iter = end;
-                return true;
+
+            auto count = policy == claim_policy::adaptive ? next_batch(current) : 1u;
+
+            // begin never carries into end, claims are at most half of what is left plus a few failed ones
+            auto claimed = bounds.fetch_add(count, std::memory_order_relaxed);
+            auto chunk = begin_of(claimed);
+            seen_end = end_of(claimed);
+            if(chunk >= end_of(claimed)) {
+                return false;
             }
-            return false;
+
+            // a thief may have split off part of the claim in between
+            auto last = std::min(chunk + count, end_of(claimed));
+            auto offset = static_cast<difference_type>(chunk) * grainsize - static_cast<difference_type>(skew);
+            auto last_offset = static_cast<difference_type>(last) * grainsize - static_cast<difference_type>(skew);
+            ret.first = base + (offset > 0 ? offset : 0);
+            ret.second = base + (last_offset < size ? last_offset : size);
+            return true;
         }
 
+        /**
+         * @brief number of chunks of the next adaptive claim; grows while nobody steals from us, but
+         * leaves at least half of the remaining chunks for thieves
+         */
+        std::uint32_t next_batch(std::uint64_t current) {
+            if(end_of(current) != seen_end) {
+                batch = 1; // somebody ran out of work, keep the pieces small
+            }
+            auto count = batch;
+            auto half = (end_of(current) - begin_of(current)) / 2;
+            count = std::max(std::min(count, half), 1u);
+            batch = count * 2;
+            return count;
+        }
 
         /**
          * @brief work_stealable checks if work can be stolen and does if available
          * @param steal_pool other work_ranges from work can be stolen
-         * @param lk1 std::unique_lock which is currently locked from this->try_fetch_work call
          * @return true if work was stolen, false otherwise
          */
-        bool work_stealable(std::list<work_range<ra_iter>>& steal_pool, std::unique_lock<std::mutex>& lk1) {
-            for(auto&& i : steal_pool) {
-                if(this != &i) {
-                    lk1.unlock(); // unlock this->m to make it ready for deadlock safe double lock -> std::lock
-                    std::unique_lock<std::mutex> lk2(i.m, std::defer_lock);
-                    std::lock(lk1, lk2);
-
-                    auto remaining_work = i.end - i.iter;
-                    if(remaining_work > grainsize) {
-                        iter = i.iter + remaining_work / 2;
-                        end = i.end;
-
-                        i.end = i.iter + remaining_work / 2;
+        template<typename Pool>
+        bool work_stealable(Pool& steal_pool) {
+            // the data of ranges worked on by our own node was most likely first touched there, so it is
+            // cheaper to take over; other nodes are only robbed once the own one ran dry
+            auto own_node = node.load(std::memory_order_relaxed);
+            bool by_node = own_node >= 0 && numa_node_count() > 1;
+
+            auto start = first_victim(steal_pool.size());
+            for(int pass = by_node ? 0 : 1; pass != 2; ++pass) {
+                for(auto n = 0u; n != steal_pool.size(); ++n) {
+                    auto& victim = steal_pool[(start + n) % steal_pool.size()];
+                    if(pass == 0 && victim.node.load(std::memory_order_relaxed) != own_node) {
+                        continue;
+                    }
+                    if(this != &victim && try_steal_from(victim)) {
                         return true;
                     }
                 }
@@ -92,6 +234,27 @@ namespace bam { namespace detail {
 
             return false;
         }
+
+        /**
+         * @brief steals the back half of the chunks of victim
+         * @return true if work was stolen, false if victim had at most one chunk left
+         */
+        bool try_steal_from(work_range<ra_iter>& victim) {
+            auto current = victim.bounds.load(std::memory_order_relaxed);
+            // retry as long as there is more than one chunk left to share
+            while(begin_of(current) < end_of(current) && end_of(current) - begin_of(current) > 1) {
+                auto mid = begin_of(current) + (end_of(current) - begin_of(current)) / 2;
+                if(victim.bounds.compare_exchange_weak(current, pack(begin_of(current), mid))) {
+                    // our own range is dry, thieves leave it alone, so a plain store is fine
+                    bounds.store(pack(mid, end_of(current)), std::memory_order_relaxed);
+                    batch = 1;
+                    seen_end = end_of(current);
+                    return true;
+                }
+            }
+
+            return false;
+        }
     };
 } }
 
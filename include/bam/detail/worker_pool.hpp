@@ -0,0 +1,276 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// worker_pool, persistent threads which run all parallel_ constructs
+
+#ifndef BAM_WORKER_POOL_HPP
+#define BAM_WORKER_POOL_HPP
+
+#include "available_cpus.hpp"
+#include "topology.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bam { namespace detail {
+
+    /**
+     * @brief a job consists of count independent steps which are claimed one after another by
+     * the calling thread and all idle workers; jobs live on the stack of the calling thread
+     */
+    class job_base {
+    public:
+        explicit job_base(std::size_t count_) : count(count_), next_index(0), active(0), queued(false), next(nullptr) {}
+
+        /**
+         * @brief runs step index, must not throw
+         */
+        virtual void execute(std::size_t index) = 0;
+
+        /**
+         * @brief claims and executes steps till all of them have been handed out
+         */
+        void participate() {
+            for(auto i = next_index.fetch_add(1); i < count; i = next_index.fetch_add(1)) {
+                execute(i);
+            }
+        }
+
+        bool exhausted() const {
+            return next_index.load() >= count;
+        }
+
+    protected:
+        ~job_base() {}
+
+    private:
+        const std::size_t count;
+        std::atomic<std::size_t> next_index;
+        int active; // workers currently participating, guarded by worker_pool::m
+        bool queued;
+        job_base* next;
+
+        friend class worker_pool;
+    };
+
+    class worker_pool {
+    public:
+        /**
+         * @brief starts worker_count persistent worker threads
+         */
+        explicit worker_pool(int worker_count) : stop(false), helpers(0), head(nullptr), tail(nullptr) {
+            threads.reserve(worker_count);
+            for(auto i = 0; i != worker_count; ++i) {
+                threads.emplace_back(&worker_pool::worker, this, i + 1);
+            }
+        }
+
+        ~worker_pool() {
+            {
+                std::lock_guard<std::mutex> lock(m);
+                stop = true;
+            }
+            work_cv.notify_all();
+
+            for(auto& t : threads) {
+                t.join();
+            }
+        }
+
+        worker_pool(const worker_pool&) = delete;
+        worker_pool& operator=(const worker_pool&) = delete;
+
+        /**
+         * @brief number of worker threads, not counting the calling thread
+         */
+        int size() const {
+            return threads.size();
+        }
+
+        /**
+         * @brief number of workers allowed to take part in jobs, at most size(), see bam::set_max_concurrency
+         */
+        int active_size() const {
+            return std::max(std::min(size(), concurrency_limit() - 1), 0);
+        }
+
+        /**
+         * @brief runs job on the workers with the calling thread joining in; returns once all steps have finished
+         */
+        void run(job_base& job) {
+            if(active_size() != 0 && job.count > 1) {
+                bool wake_helpers;
+                {
+                    std::lock_guard<std::mutex> lock(m);
+                    enqueue(job);
+                    wake_helpers = helpers != 0;
+                }
+                work_cv.notify_all();
+                if(wake_helpers) {
+                    done_cv.notify_all();
+                }
+            }
+
+            job.participate();
+
+            // once dequeued no further worker can join, so we only have to wait for the current ones
+            std::unique_lock<std::mutex> lock(m);
+            dequeue(job);
+            if(!on_worker()) {
+                done_cv.wait(lock, [&] { return job.active == 0; });
+                return;
+            }
+
+            // nested call on a worker, help with other jobs instead of idling while the last steps finish
+            ++helpers;
+            while(job.active != 0) {
+                if(auto other = open_job()) {
+                    join(*other, lock);
+                }
+                else {
+                    done_cv.wait(lock);
+                }
+            }
+            --helpers;
+        }
+
+        /**
+         * @brief whether the calling thread is one of the workers, such that parallel_ calls can tell if they are nested
+         */
+        static bool on_worker() {
+            return current_slot() != 0;
+        }
+
+        /**
+         * @brief stable id of the calling thread within the pool, 1 to size() for the workers and 0 for all other threads
+         */
+        static int current_slot() {
+            return slot_id();
+        }
+
+    private:
+        std::mutex m;
+        std::condition_variable work_cv;
+        std::condition_variable done_cv;
+        bool stop;
+        int helpers; // nested callers waiting for their job, also woken when jobs are enqueued
+        job_base* head;
+        job_base* tail;
+        std::vector<std::thread> threads;
+
+        /**
+         * @brief worker helper function the threads will run
+         * @param slot id of the worker, see current_slot
+         */
+        void worker(int slot) {
+            slot_id() = slot;
+            if(pin_workers()) {
+                pin_current_thread(worker_cpu(slot).cpu);
+            }
+
+            std::unique_lock<std::mutex> lock(m);
+            while(true) {
+                work_cv.wait(lock, [&] { return stop || (head != nullptr && slot <= active_size()); });
+                if(stop) {
+                    return;
+                }
+
+                job_base& job = *head;
+                if(job.exhausted()) {
+                    dequeue(job);
+                    continue;
+                }
+
+                join(job, lock);
+            }
+        }
+
+        static int& slot_id() {
+            static thread_local int slot = 0;
+            return slot;
+        }
+
+        //! participates in job, lock has to hold m and holds it again on return
+        void join(job_base& job, std::unique_lock<std::mutex>& lock) {
+            ++job.active;
+            lock.unlock();
+            job.participate();
+            lock.lock();
+
+            // job may be destroyed as soon as active drops to zero and the lock is released
+            dequeue(job);
+            if(--job.active == 0) {
+                done_cv.notify_all();
+            }
+        }
+
+        //! first queued job with steps left, m has to be locked
+        job_base* open_job() {
+            for(auto it = head; it; it = it->next) {
+                if(!it->exhausted()) {
+                    return it;
+                }
+            }
+            return nullptr;
+        }
+
+        //! appends job to the queue, m has to be locked
+        void enqueue(job_base& job) {
+            job.queued = true;
+            job.next = nullptr;
+            if(tail) {
+                tail->next = &job;
+            }
+            else {
+                head = &job;
+            }
+            tail = &job;
+        }
+
+        //! removes job from the queue if it is still queued, m has to be locked
+        void dequeue(job_base& job) {
+            if(!job.queued) {
+                return;
+            }
+
+            job_base* prev = nullptr;
+            for(auto it = head; it != &job; it = it->next) {
+                prev = it;
+            }
+
+            if(prev) {
+                prev->next = job.next;
+            }
+            else {
+                head = job.next;
+            }
+            if(tail == &job) {
+                tail = prev;
+            }
+            job.queued = false;
+        }
+    };
+
+    /**
+     * @brief number of persistent workers; the calling thread always joins in, hence one less than the concurrency
+     */
+    inline int get_worker_count() {
+        return concurrency_limit() - 1;
+    }
+
+    /**
+     * @brief get the lazily started, process wide worker pool
+     */
+    inline worker_pool& get_worker_pool() {
+        static worker_pool pool(get_worker_count());
+        return pool;
+    }
+} }
+
+#endif // BAM_WORKER_POOL_HPP
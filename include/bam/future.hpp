@@ -0,0 +1,569 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef BAM_FUTURE_HPP
+#define BAM_FUTURE_HPP
+
+#include "detail/function_wrapper.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace bam {
+
+    namespace detail {
+
+        /**
+         * @brief per thread cache of memory blocks for one shared state type, blocks go back to the
+         * cache of whichever thread drops the last reference
+         */
+        template<typename State>
+        class state_freelist {
+        public:
+            state_freelist() : head(nullptr), count(0) {}
+
+            ~state_freelist() {
+                while(head) {
+                    auto next = head->next;
+                    ::operator delete(head);
+                    head = next;
+                }
+            }
+
+            void* allocate() {
+                if(head) {
+                    auto ret = head;
+                    head = head->next;
+                    --count;
+                    return ret;
+                }
+                return ::operator new(sizeof(State));
+            }
+
+            void deallocate(void* p) {
+                if(count == max_cached) {
+                    ::operator delete(p);
+                    return;
+                }
+                auto b = static_cast<block*>(p);
+                b->next = head;
+                head = b;
+                ++count;
+            }
+
+            static state_freelist& local() {
+                static thread_local state_freelist list;
+                return list;
+            }
+
+        private:
+            static const std::size_t max_cached = 64;
+
+            struct block {
+                block* next;
+            };
+
+            block* head;
+            std::size_t count;
+        };
+
+        /**
+         * @brief mutexes and condition variables for futures which actually have to block, shared by address
+         */
+        struct parking_spot {
+            std::mutex m;
+            std::condition_variable cv;
+        };
+
+        inline parking_spot& get_parking_spot(const void* address) {
+            static parking_spot spots[64];
+            return spots[(reinterpret_cast<std::uintptr_t>(address) / 64) % 64];
+        }
+
+        /**
+         * @brief hook which lets a thread run other tasks while it waits for a future, installed by
+         * task_pool workers such that tasks waiting on tasks don't block their worker
+         */
+        struct wait_helper {
+            bool (*run_one)(void* context); // runs one queued task, false if there was none
+            void* context;
+        };
+
+        inline wait_helper& current_wait_helper() {
+            static thread_local wait_helper helper = { nullptr, nullptr };
+            return helper;
+        }
+
+        /**
+         * @brief type independent part of the shared state between a future and its producer
+         *
+         * Completing only sets the ready bit; the parking spot is only touched if the consumer
+         * registered itself as waiting before that.
+         */
+        class future_state_base {
+        public:
+            explicit future_state_base(void (*destroy_)(future_state_base*)) : status(0), refs(1), destroy(destroy_) {}
+
+            bool ready() const {
+                return status.load(std::memory_order_acquire) & ready_bit;
+            }
+
+            bool is_deferred() const {
+                return has_deferred;
+            }
+
+            //! runs the deferred function if there is one which didn't run yet
+            void run_deferred() {
+                if(has_deferred && !ready()) {
+                    deferred();
+                }
+            }
+
+            void wait() {
+                run_deferred();
+                if(ready()) {
+                    return;
+                }
+
+                auto& helper = current_wait_helper();
+                if(helper.run_one) {
+                    while(!ready()) {
+                        if(!helper.run_one(helper.context)) {
+                            // nothing to help with, the awaited task runs elsewhere; check back for new work now and then
+                            wait_for(std::chrono::microseconds(100));
+                        }
+                    }
+                    return;
+                }
+
+                auto& spot = get_parking_spot(this);
+                std::unique_lock<std::mutex> lock(spot.m);
+                if(status.fetch_or(waiter_bit, std::memory_order_acq_rel) & ready_bit) {
+                    return;
+                }
+                spot.cv.wait(lock, [&] { return ready(); });
+            }
+
+            template<typename Rep, typename Period>
+            std::future_status wait_for(const std::chrono::duration<Rep, Period>& duration) {
+                if(has_deferred && !ready()) {
+                    return std::future_status::deferred;
+                }
+                if(ready()) {
+                    return std::future_status::ready;
+                }
+
+                auto& spot = get_parking_spot(this);
+                std::unique_lock<std::mutex> lock(spot.m);
+                if(status.fetch_or(waiter_bit, std::memory_order_acq_rel) & ready_bit) {
+                    return std::future_status::ready;
+                }
+                return spot.cv.wait_for(lock, duration, [&] { return ready(); }) ? std::future_status::ready : std::future_status::timeout;
+            }
+
+            void set_exception(std::exception_ptr e) {
+                error = e;
+                make_ready();
+            }
+
+            void add_ref() {
+                refs.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            void release() {
+                if(refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    destroy(this);
+                }
+            }
+
+            //! turns this state into the state of a deferred function, which is run by the first wait
+            void set_deferred(function_wrapper foo) {
+                deferred = std::move(foo);
+                has_deferred = true;
+            }
+
+        protected:
+            ~future_state_base() {}
+
+            std::exception_ptr error;
+
+            void make_ready() {
+                if(status.fetch_or(ready_bit, std::memory_order_acq_rel) & waiter_bit) {
+                    auto& spot = get_parking_spot(this);
+                    std::lock_guard<std::mutex> lock(spot.m);
+                    spot.cv.notify_all();
+                }
+            }
+
+            void rethrow_if_error() {
+                if(error) {
+                    std::rethrow_exception(error);
+                }
+            }
+
+        private:
+            static const unsigned ready_bit = 1;
+            static const unsigned waiter_bit = 2;
+
+            std::atomic<unsigned> status;
+            std::atomic<int> refs;
+            void (*destroy)(future_state_base*);
+            bool has_deferred = false;
+            function_wrapper deferred;
+        };
+
+        template<typename T>
+        class future_state : public future_state_base {
+        public:
+            future_state() : future_state_base(&recycle), has_value(false) {}
+
+            ~future_state() {
+                if(has_value) {
+                    value_ptr()->~T();
+                }
+            }
+
+            //! allocates a state from the freelist of the calling thread, holding one reference
+            static future_state* create() {
+                return new (state_freelist<future_state>::local().allocate()) future_state();
+            }
+
+            template<typename V>
+            void set_value(V&& v) {
+                new (&storage) T(std::forward<V>(v));
+                has_value = true;
+                make_ready();
+            }
+
+            //! runs foo and stores its result or exception
+            template<typename F>
+            void fulfill(F& foo) {
+                try {
+                    set_value(foo());
+                } catch(...) {
+                    set_exception(std::current_exception());
+                }
+            }
+
+            T take() {
+                rethrow_if_error();
+                return std::move(*value_ptr());
+            }
+
+        private:
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+            bool has_value;
+
+            T* value_ptr() {
+                return reinterpret_cast<T*>(&storage);
+            }
+
+            static void recycle(future_state_base* base) {
+                auto self = static_cast<future_state*>(base);
+                self->~future_state();
+                state_freelist<future_state>::local().deallocate(self);
+            }
+        };
+
+        template<>
+        class future_state<void> : public future_state_base {
+        public:
+            future_state() : future_state_base(&recycle) {}
+
+            static future_state* create() {
+                return new (state_freelist<future_state>::local().allocate()) future_state();
+            }
+
+            void set_value() {
+                make_ready();
+            }
+
+            template<typename F>
+            void fulfill(F& foo) {
+                try {
+                    foo();
+                    set_value();
+                } catch(...) {
+                    set_exception(std::current_exception());
+                }
+            }
+
+            void take() {
+                rethrow_if_error();
+            }
+
+        private:
+            static void recycle(future_state_base* base) {
+                auto self = static_cast<future_state*>(base);
+                self->~future_state();
+                state_freelist<future_state>::local().deallocate(self);
+            }
+        };
+
+        /**
+         * @brief task which runs foo, completes the state and drops its reference. Trivially copyable whenever
+         * foo is, such that function_wrapper can store it inline.
+         */
+        template<typename F, typename R>
+        struct promised_task {
+            F foo;
+            future_state<R>* state;
+
+            void operator()() {
+                state->fulfill(foo);
+                state->release();
+                state = nullptr;
+            }
+
+            //! called by function_wrapper before it drops the task; one which never ran breaks its promise like bam::promise
+            void abandon() {
+                if(state) {
+                    state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+                    state->release();
+                    state = nullptr;
+                }
+            }
+        };
+
+        //! deferred function stored in its own state, the state is kept alive by the future
+        template<typename F, typename R>
+        struct deferred_task {
+            F foo;
+            future_state<R>* state;
+
+            void operator()() {
+                state->fulfill(foo);
+            }
+        };
+
+        //! binds arguments to a function, without any arguments the function is used as is
+        template<typename function>
+        typename std::decay<function>::type bind_task(function&& f) {
+            return std::forward<function>(f);
+        }
+
+        template<typename function, typename Arg, typename ...Args>
+        auto bind_task(function&& f, Arg&& arg, Args&& ...args)
+          -> decltype(std::bind(std::forward<function>(f), std::forward<Arg>(arg), std::forward<Args>(args)...))
+        {
+            return std::bind(std::forward<function>(f), std::forward<Arg>(arg), std::forward<Args>(args)...);
+        }
+    }
+
+    template<typename T>
+    class promise;
+
+    /**
+     * @brief lightweight replacement for std::future as returned by task_pool, async_task_pool and bam::async
+     *
+     * The shared state is recycled through a per thread freelist, completing it is a single atomic
+     * operation unless somebody already blocks on it. Destroying a future never blocks.
+     */
+    template<typename T>
+    class future {
+    public:
+        future() : state(nullptr) {}
+
+        explicit future(detail::future_state<T>* state_) : state(state_) {}
+
+        future(future&& other) : state(other.state) {
+            other.state = nullptr;
+        }
+
+        future& operator=(future&& other) {
+            if(this != &other) {
+                reset();
+                state = other.state;
+                other.state = nullptr;
+            }
+            return *this;
+        }
+
+        future(const future&) = delete;
+        future& operator=(const future&) = delete;
+
+        ~future() {
+            reset();
+        }
+
+        //! true if the future refers to a shared state, false after get or for default constructed futures
+        bool valid() const {
+            return state != nullptr;
+        }
+
+        //! true if the result is available, never blocks
+        bool ready() const {
+            return state && state->ready();
+        }
+
+        //! blocks until the result is available, runs deferred functions
+        void wait() const {
+            state->wait();
+        }
+
+        template<typename Rep, typename Period>
+        std::future_status wait_for(const std::chrono::duration<Rep, Period>& duration) const {
+            return state->wait_for(duration);
+        }
+
+        /**
+         * @brief waits for and returns the result, rethrows an exception if one was stored
+         * the future is invalid afterwards
+         */
+        T get() {
+            state->wait();
+            future_guard guard(*this);
+            return state->take();
+        }
+
+    private:
+        detail::future_state<T>* state;
+
+        //! releases the state also in case take throws
+        struct future_guard {
+            future& f;
+            explicit future_guard(future& f_) : f(f_) {}
+            ~future_guard() { f.reset(); }
+        };
+
+        void reset() {
+            if(state) {
+                state->release();
+                state = nullptr;
+            }
+        }
+    };
+
+    /**
+     * @brief producer side of a bam::future; like std::promise it throws std::future_error with
+     * promise_already_satisfied if a result is set twice, and with no_state once it was moved from
+     */
+    template<typename T>
+    class promise {
+    public:
+        promise() : state(detail::future_state<T>::create()), retrieved(false), satisfied(false) {}
+
+        promise(promise&& other) : state(other.state), retrieved(other.retrieved), satisfied(other.satisfied) {
+            other.state = nullptr;
+        }
+
+        promise& operator=(promise&& other) {
+            if(this != &other) {
+                abandon();
+                state = other.state;
+                retrieved = other.retrieved;
+                satisfied = other.satisfied;
+                other.state = nullptr;
+            }
+            return *this;
+        }
+
+        promise(const promise&) = delete;
+        promise& operator=(const promise&) = delete;
+
+        //! a promise destroyed before setting a result breaks the promise
+        ~promise() {
+            abandon();
+        }
+
+        future<T> get_future() {
+            if(!state) {
+                throw std::future_error(std::future_errc::no_state);
+            }
+            if(retrieved) {
+                throw std::future_error(std::future_errc::future_already_retrieved);
+            }
+            retrieved = true;
+            state->add_ref();
+            return future<T>(state);
+        }
+
+        template<typename ...V>
+        void set_value(V&& ...v) {
+            check_unsatisfied();
+            state->set_value(std::forward<V>(v)...);
+            satisfied = true;
+        }
+
+        void set_exception(std::exception_ptr e) {
+            check_unsatisfied();
+            state->set_exception(e);
+            satisfied = true;
+        }
+
+    private:
+        detail::future_state<T>* state; // null once moved from, kept after the result is set such that get_future still works
+        bool retrieved;
+        bool satisfied;
+
+        void check_unsatisfied() const {
+            if(!state) {
+                throw std::future_error(std::future_errc::no_state);
+            }
+            if(satisfied) {
+                throw std::future_error(std::future_errc::promise_already_satisfied);
+            }
+        }
+
+        void abandon() {
+            if(!state) {
+                return;
+            }
+            if(!satisfied) {
+                state->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+            }
+            state->release();
+            state = nullptr;
+        }
+    };
+
+    namespace detail {
+
+        /**
+         * @brief creates a state and the task which completes it
+         * @return pair of the task, ready to be wrapped in a function_wrapper, and the future
+         */
+        template<typename function, typename ...Args>
+        auto make_promised_task(function&& f, Args&& ...args)
+          -> std::pair<
+                promised_task<decltype(bind_task(std::forward<function>(f), std::forward<Args>(args)...)), typename std::result_of<function(Args...)>::type>,
+                future<typename std::result_of<function(Args...)>::type>
+             >
+        {
+            typedef typename std::result_of<function(Args...)>::type return_type;
+            typedef decltype(bind_task(std::forward<function>(f), std::forward<Args>(args)...)) bound_type;
+
+            auto state = future_state<return_type>::create();
+            state->add_ref(); // one for the future and one for the task
+            promised_task<bound_type, return_type> task = { bind_task(std::forward<function>(f), std::forward<Args>(args)...), state };
+            return std::make_pair(std::move(task), future<return_type>(state));
+        }
+
+        /**
+         * @brief creates a future whose function is only run by the first call to wait or get
+         */
+        template<typename function, typename ...Args>
+        future<typename std::result_of<function(Args...)>::type> make_deferred_future(function&& f, Args&& ...args) {
+            typedef typename std::result_of<function(Args...)>::type return_type;
+            typedef decltype(bind_task(std::forward<function>(f), std::forward<Args>(args)...)) bound_type;
+
+            auto state = future_state<return_type>::create(); // nobody but the future holds the state
+            deferred_task<bound_type, return_type> task = { bind_task(std::forward<function>(f), std::forward<Args>(args)...), state };
+            state->set_deferred(std::move(task));
+            return future<return_type>(state);
+        }
+    }
+}
+
+#endif // BAM_FUTURE_HPP
@@ -0,0 +1,95 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// numa aware memory placement: pages are placed on the node of the thread which touches them first
+
+#ifndef BAM_NUMA_HPP
+#define BAM_NUMA_HPP
+
+#include "detail/numa_nodes.hpp"
+#include "parallel_for.hpp"
+#include "partitioner.hpp"
+
+#include <boost/range.hpp>
+
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace bam {
+
+    /**
+     * @brief std::allocator which default initializes instead of value initializing, such that
+     * std::vector<double, first_touch_allocator<double>> v(n) leaves the pages of v untouched until
+     * parallel_first_touch writes them from the threads which will work on them later
+     */
+    template<typename T>
+    class first_touch_allocator : public std::allocator<T> {
+    public:
+        template<typename U>
+        struct rebind {
+            typedef first_touch_allocator<U> other;
+        };
+
+        first_touch_allocator() = default;
+
+        template<typename U>
+        first_touch_allocator(const first_touch_allocator<U>&) {}
+
+        template<typename U>
+        void construct(U* p) {
+            ::new (static_cast<void*>(p)) U;
+        }
+
+        template<typename U, typename ...Args>
+        void construct(U* p, Args&& ...args) {
+            ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+        }
+    };
+
+    //! vector whose elements are only touched by parallel_first_touch
+    template<typename T>
+    using first_touch_vector = std::vector<T, first_touch_allocator<T>>;
+
+    /**
+     * \brief assigns value to every element in parallel, such that every page is first touched, and hence
+     * placed, on the numa node of the worker which wrote it
+     *
+     * Pass the affinity_partitioner which the later parallel_ calls on the range use: it hands the same pieces
+     * to the same workers again, so they find their data on their own node. Combined with pinned workers,
+     * see bam::set_worker_pinning, the placement survives the scheduler moving threads around.
+     * \param begin begin iterator of the freshly allocated range
+     * \param end end iterator of the freshly allocated range
+     * \param value value to assign to every element
+     * \param part partitioner to be reused by the parallel_ calls working on the range
+     */
+    template<typename ra_iter, typename T, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_first_touch(ra_iter begin, ra_iter end, const T& value, const partitioner& part) {
+        parallel_for(begin, end, [&value] (ra_iter b, ra_iter e) {
+            for(auto it = b; it != e; ++it) {
+                *it = value;
+            }
+        }, part);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_first_touch
+     */
+    template<typename range, typename T, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_first_touch(range&& rng, const T& value, const partitioner& part) {
+        parallel_first_touch(boost::begin(rng), boost::end(rng), value, part);
+    }
+
+    /**
+     * @brief number of numa nodes with cpus, 1 on machines without numa
+     */
+    inline int numa_node_count() {
+        return detail::numa_node_count();
+    }
+}
+
+#endif // BAM_NUMA_HPP
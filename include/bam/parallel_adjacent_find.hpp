@@ -0,0 +1,218 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// checks on neighbouring elements: parallel_adjacent_find, parallel_is_sorted and parallel_is_partitioned
+
+#ifndef BAM_PARALLEL_ADJACENT_FIND_HPP
+#define BAM_PARALLEL_ADJACENT_FIND_HPP
+
+#include "parallel_find.hpp"
+#include "partitioner.hpp"
+
+#include <boost/range.hpp>
+
+namespace bam {
+    namespace detail {
+        //! compares two elements the way std::adjacent_find does
+        struct equal_elements {
+            template<typename T, typename U>
+            bool operator()(const T& a, const U& b) const {
+                return a == b;
+            }
+        };
+
+        //! compares two elements the way std::is_sorted does
+        struct less_elements {
+            template<typename T, typename U>
+            bool operator()(const T& a, const U& b) const {
+                return a < b;
+            }
+        };
+
+        /**
+         * @brief first element of [begin, end) for which pred holds together with its successor, every element
+         * but the last one is checked by exactly one chunk
+         */
+        template<typename Iter, typename binary_predicate, typename partitioner>
+        Iter parallel_adjacent_find_impl(Iter begin, Iter end, binary_predicate pred, const partitioner& part) {
+            if(end - begin < 2) {
+                return end;
+            }
+
+            auto last_pair = end - 1;
+            auto found = parallel_search_impl(begin, last_pair, [&pred] (Iter first, Iter last) -> Iter {
+                for(auto it = first; it != last; ++it) {
+                    if(pred(*it, *(it + 1))) {
+                        return it;
+                    }
+                }
+                return last;
+            }, part);
+            return found != last_pair ? found : end;
+        }
+
+        //! an element which is greater than its successor breaks the order
+        template<typename compare>
+        struct out_of_order {
+            compare comp;
+
+            template<typename T, typename U>
+            bool operator()(const T& a, const U& b) const {
+                return comp(b, a);
+            }
+        };
+
+        //! an element which fails pred followed by one which fulfills it breaks the partition
+        template<typename predicate>
+        struct partition_break {
+            predicate pred;
+
+            template<typename T, typename U>
+            bool operator()(const T& a, const U& b) const {
+                return !pred(a) && pred(b);
+            }
+        };
+    }
+
+    /**
+     * \brief searches the first two neighbouring elements for which pred holds, like std::adjacent_find
+     * \return iterator to the first of the two elements, end if there are none
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename Iter, typename binary_predicate>
+    Iter parallel_adjacent_find(Iter begin, Iter end, binary_predicate pred, int grainsize = 0) {
+        return detail::parallel_adjacent_find_impl(begin, end, std::move(pred), simple_partitioner(grainsize));
+    }
+
+    /**
+     * \brief parallel_adjacent_find with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename Iter, typename binary_predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, Iter>::type
+    parallel_adjacent_find(Iter begin, Iter end, binary_predicate pred, const partitioner& part) {
+        return detail::parallel_adjacent_find_impl(begin, end, std::move(pred), part);
+    }
+
+    /**
+     * \brief searches the first two neighbouring elements which are equal
+     */
+    template<typename Iter>
+    Iter parallel_adjacent_find(Iter begin, Iter end) {
+        return parallel_adjacent_find(begin, end, detail::equal_elements());
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_adjacent_find
+     */
+    template<typename Range, typename binary_predicate>
+    auto parallel_adjacent_find(Range&& rng, binary_predicate pred, int grainsize = 0) -> decltype(boost::begin(rng)) {
+        return parallel_adjacent_find(boost::begin(rng), boost::end(rng), std::move(pred), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_adjacent_find with a partitioner
+     */
+    template<typename Range, typename binary_predicate, typename partitioner>
+    auto parallel_adjacent_find(Range&& rng, binary_predicate pred, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, decltype(boost::begin(rng))>::type {
+        return parallel_adjacent_find(boost::begin(rng), boost::end(rng), std::move(pred), part);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_adjacent_find comparing with ==
+     */
+    template<typename Range>
+    auto parallel_adjacent_find(Range&& rng) -> decltype(boost::begin(rng)) {
+        return parallel_adjacent_find(boost::begin(rng), boost::end(rng));
+    }
+
+    /**
+     * \brief checks whether [begin, end) is sorted with respect to comp, like std::is_sorted
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename Iter, typename compare>
+    bool parallel_is_sorted(Iter begin, Iter end, compare comp, int grainsize = 0) {
+        return parallel_adjacent_find(begin, end, detail::out_of_order<compare>{ std::move(comp) }, grainsize) == end;
+    }
+
+    /**
+     * \brief parallel_is_sorted with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename Iter, typename compare, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, bool>::type
+    parallel_is_sorted(Iter begin, Iter end, compare comp, const partitioner& part) {
+        return parallel_adjacent_find(begin, end, detail::out_of_order<compare>{ std::move(comp) }, part) == end;
+    }
+
+    /**
+     * \brief checks whether [begin, end) is sorted in ascending order
+     */
+    template<typename Iter>
+    bool parallel_is_sorted(Iter begin, Iter end) {
+        return parallel_is_sorted(begin, end, detail::less_elements());
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_is_sorted
+     */
+    template<typename Range, typename compare>
+    auto parallel_is_sorted(Range&& rng, compare comp, int grainsize = 0) -> decltype(boost::begin(rng), true) {
+        return parallel_is_sorted(boost::begin(rng), boost::end(rng), std::move(comp), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_is_sorted with a partitioner
+     */
+    template<typename Range, typename compare, typename partitioner>
+    auto parallel_is_sorted(Range&& rng, compare comp, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, decltype(boost::begin(rng), true)>::type {
+        return parallel_is_sorted(boost::begin(rng), boost::end(rng), std::move(comp), part);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_is_sorted in ascending order
+     */
+    template<typename Range>
+    auto parallel_is_sorted(Range&& rng) -> decltype(boost::begin(rng), true) {
+        return parallel_is_sorted(boost::begin(rng), boost::end(rng));
+    }
+
+    /**
+     * \brief checks whether all elements of [begin, end) which fulfill pred come before the ones which don't,
+     * like std::is_partitioned
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename Iter, typename predicate>
+    bool parallel_is_partitioned(Iter begin, Iter end, predicate pred, int grainsize = 0) {
+        return parallel_adjacent_find(begin, end, detail::partition_break<predicate>{ std::move(pred) }, grainsize) == end;
+    }
+
+    /**
+     * \brief parallel_is_partitioned with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename Iter, typename predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, bool>::type
+    parallel_is_partitioned(Iter begin, Iter end, predicate pred, const partitioner& part) {
+        return parallel_adjacent_find(begin, end, detail::partition_break<predicate>{ std::move(pred) }, part) == end;
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_is_partitioned
+     */
+    template<typename Range, typename predicate>
+    auto parallel_is_partitioned(Range&& rng, predicate pred, int grainsize = 0) -> decltype(boost::begin(rng), true) {
+        return parallel_is_partitioned(boost::begin(rng), boost::end(rng), std::move(pred), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_is_partitioned with a partitioner
+     */
+    template<typename Range, typename predicate, typename partitioner>
+    auto parallel_is_partitioned(Range&& rng, predicate pred, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, decltype(boost::begin(rng), true)>::type {
+        return parallel_is_partitioned(boost::begin(rng), boost::end(rng), std::move(pred), part);
+    }
+}
+
+#endif // BAM_PARALLEL_ADJACENT_FIND_HPP
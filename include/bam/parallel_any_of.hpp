@@ -0,0 +1,140 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// parallel_any_of, parallel_all_of and parallel_none_of, the first deciding element ends the scan of all threads
+
+#ifndef BAM_PARALLEL_ANY_OF_HPP
+#define BAM_PARALLEL_ANY_OF_HPP
+
+#include "parallel_find.hpp"
+#include "partitioner.hpp"
+
+#include <boost/range.hpp>
+
+namespace bam {
+    namespace detail {
+        //! negates a predicate like std::not1, without requiring argument_type
+        template<typename predicate>
+        struct negated {
+            predicate pred;
+
+            template<typename T>
+            bool operator()(T&& x) const {
+                return !pred(std::forward<T>(x));
+            }
+        };
+
+        template<typename predicate>
+        negated<predicate> negate(predicate pred) {
+            return negated<predicate>{ std::move(pred) };
+        }
+    }
+
+    /**
+     * \brief checks whether pred holds for at least one element of [begin, end), like std::any_of
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename Iter, typename predicate>
+    bool parallel_any_of(Iter begin, Iter end, predicate pred, int grainsize = 0) {
+        return detail::parallel_find_if_impl(begin, end, std::move(pred), simple_partitioner(grainsize)) != end;
+    }
+
+    /**
+     * \brief parallel_any_of with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename Iter, typename predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, bool>::type
+    parallel_any_of(Iter begin, Iter end, predicate pred, const partitioner& part) {
+        return detail::parallel_find_if_impl(begin, end, std::move(pred), part) != end;
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_any_of
+     */
+    template<typename Range, typename predicate>
+    auto parallel_any_of(Range&& rng, predicate pred, int grainsize = 0) -> decltype(boost::begin(rng), true) {
+        return parallel_any_of(boost::begin(rng), boost::end(rng), std::move(pred), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_any_of with a partitioner
+     */
+    template<typename Range, typename predicate, typename partitioner>
+    auto parallel_any_of(Range&& rng, predicate pred, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, decltype(boost::begin(rng), true)>::type {
+        return parallel_any_of(boost::begin(rng), boost::end(rng), std::move(pred), part);
+    }
+
+    /**
+     * \brief checks whether pred holds for all elements of [begin, end), like std::all_of
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename Iter, typename predicate>
+    bool parallel_all_of(Iter begin, Iter end, predicate pred, int grainsize = 0) {
+        return !parallel_any_of(begin, end, detail::negate(std::move(pred)), grainsize);
+    }
+
+    /**
+     * \brief parallel_all_of with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename Iter, typename predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, bool>::type
+    parallel_all_of(Iter begin, Iter end, predicate pred, const partitioner& part) {
+        return !parallel_any_of(begin, end, detail::negate(std::move(pred)), part);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_all_of
+     */
+    template<typename Range, typename predicate>
+    auto parallel_all_of(Range&& rng, predicate pred, int grainsize = 0) -> decltype(boost::begin(rng), true) {
+        return parallel_all_of(boost::begin(rng), boost::end(rng), std::move(pred), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_all_of with a partitioner
+     */
+    template<typename Range, typename predicate, typename partitioner>
+    auto parallel_all_of(Range&& rng, predicate pred, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, decltype(boost::begin(rng), true)>::type {
+        return parallel_all_of(boost::begin(rng), boost::end(rng), std::move(pred), part);
+    }
+
+    /**
+     * \brief checks whether pred holds for no element of [begin, end), like std::none_of
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename Iter, typename predicate>
+    bool parallel_none_of(Iter begin, Iter end, predicate pred, int grainsize = 0) {
+        return !parallel_any_of(begin, end, std::move(pred), grainsize);
+    }
+
+    /**
+     * \brief parallel_none_of with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename Iter, typename predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, bool>::type
+    parallel_none_of(Iter begin, Iter end, predicate pred, const partitioner& part) {
+        return !parallel_any_of(begin, end, std::move(pred), part);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_none_of
+     */
+    template<typename Range, typename predicate>
+    auto parallel_none_of(Range&& rng, predicate pred, int grainsize = 0) -> decltype(boost::begin(rng), true) {
+        return parallel_none_of(boost::begin(rng), boost::end(rng), std::move(pred), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_none_of with a partitioner
+     */
+    template<typename Range, typename predicate, typename partitioner>
+    auto parallel_none_of(Range&& rng, predicate pred, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, decltype(boost::begin(rng), true)>::type {
+        return parallel_none_of(boost::begin(rng), boost::end(rng), std::move(pred), part);
+    }
+}
+
+#endif // BAM_PARALLEL_ANY_OF_HPP
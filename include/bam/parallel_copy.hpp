@@ -10,6 +10,20 @@
 #include <iterator>
 
 namespace bam {
+    /**
+     * \brief parallel_copy with a partitioner deciding how the range is cut into pieces
+     * \param part partitioner, e.g. bam::auto_partitioner or one carrying a cancellation_token
+     */
+    template<typename InputIterator, typename OutputIterator, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_copy(InputIterator begin, InputIterator end, OutputIterator dest, const partitioner& part) {
+        auto helper = [=] (InputIterator b, InputIterator e) {
+            std::copy(b, e, std::next(dest, std::distance(begin, b)));
+        };
+
+        parallel_for(begin, end, helper, part);
+    }
+
     /**
      * \brief parallel_copy algorithm, replacing serial std::copy
      * \param begin begin iterator of the range to be worked on
@@ -18,11 +32,7 @@ namespace bam {
      */
     template<typename InputIterator, typename OutputIterator>
     void parallel_copy(InputIterator begin, InputIterator end, OutputIterator dest) {
-        auto helper = [=] (InputIterator b, InputIterator e) {
-            std::copy(b, e, std::next(dest, std::distance(begin, b)));
-        };
-
-        parallel_for(begin, end, helper);
+        parallel_copy(begin, end, dest, simple_partitioner());
     }
 
     /**
@@ -33,6 +43,15 @@ namespace bam {
         parallel_copy(boost::begin(rng), boost::end(rng), target);
     }
 
+    /**
+     * @brief range wrapper for bam::parallel_copy with a partitioner
+     */
+    template<typename Range, typename Oiter, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_copy(const Range& rng, Oiter target, const partitioner& part) {
+        parallel_copy(boost::begin(rng), boost::end(rng), target, part);
+    }
+
 }
 
 #endif // BAM_PARALLEL_COPY_HPP
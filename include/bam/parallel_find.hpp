@@ -7,73 +7,179 @@
 
 #include "detail/work_range.hpp"
 #include "detail/parallel_utility.hpp"
+#include "partitioner.hpp"
 #include <boost/range/algorithm.hpp>
+#include <algorithm>
 #include <tuple>
 #include <atomic>
 
 namespace bam {
     namespace detail {
-        // looks for a non-end iterator and then returns it
-        template<typename Container, typename Iter>
-        Iter join_iter(Container& c, Iter default_iter) {
-            for(auto&& task : c) {
-                auto iter = task.get();
-                if(iter != default_iter) {
-                    return iter;
+        //! compares with a value the way std::find does
+        template<typename T>
+        struct equal_to_value {
+            const T& val;
+
+            template<typename U>
+            bool operator()(const U& x) const {
+                return x == val;
+            }
+        };
+
+        //! lowers best to index unless it is lower already
+        template<typename difference_type>
+        void lower_to(std::atomic<difference_type>& best, difference_type index) {
+            auto current = best.load(std::memory_order_relaxed);
+            while(index < current && !best.compare_exchange_weak(current, index, std::memory_order_relaxed)) {}
+        }
+
+        /**
+         * @brief searches the first position of [begin, end) which find_in reports; threads share the index of
+         * the first match so far and skip every chunk behind it, such that an early match ends the search quickly
+         * @param find_in returns the first match in [first, last), last if there is none
+         */
+        template<typename Iter, typename search_predicate, typename partitioner>
+        Iter parallel_search_impl(Iter begin, Iter end, search_predicate find_in, const partitioner& part) {
+            typedef typename detail::work_range<Iter>::difference_type difference_type;
+            detail::stop_state stop(part.get_cancellation_token(), part.collects_exceptions());
+
+            // small ranges are cheaper to search right here, stop probing once a match showed up
+            auto found = end;
+            auto search_front = [&] (Iter first, Iter last) {
+                if(found == end && !stop.stop_requested()) {
+                    auto iter = stop.run(find_in, first, last);
+                    found = iter != last ? iter : end;
                 }
+            };
+            if(detail::run_below_cutoff(begin, end, search_front, part.get_cost_hint(), part.get_grainsize()) || found != end) {
+                stop.get_token().throw_if_cancelled();
+                return found;
+            }
+
+            // get params work_piece_per_thread and grainsize
+            auto grainsize = part.get_grainsize();
+            auto work_piece_per_thread = 0;
+            std::tie(grainsize, work_piece_per_thread) = detail::get_scheduler_params<typename detail::range_element<Iter>::type>(end - begin, grainsize);
+
+            if(work_piece_per_thread == 0) {
+                stop.get_token().throw_if_cancelled();
+                return end;
             }
-            
-            return default_iter;
+
+            // build work
+            std::atomic<difference_type> best(end - begin); // index of the first match so far
+            detail::work_ranges<Iter> work;
+            detail::make_work(work, begin, end, work_piece_per_thread, grainsize, get_claim_policy(part), part.get_grainsize() == 0);
+
+            // helper function which the threads will run, chunks behind the best match are claimed but not searched
+            auto work_helper = [&] (detail::work_range<Iter>& work_rng) {
+                std::pair<Iter, Iter> work_chunk;
+                while(!stop.stop_requested() && work_rng.try_fetch_work(work_chunk, work)) {
+                    auto limit = begin + best.load(std::memory_order_relaxed);
+                    if(!(work_chunk.first < limit)) {
+                        continue;
+                    }
+                    auto last = work_chunk.second < limit ? work_chunk.second : limit;
+                    auto found_iter = stop.run(find_in, work_chunk.first, last);
+                    if(found_iter != last) {
+                        lower_to(best, static_cast<difference_type>(found_iter - begin));
+                    }
+                }
+            };
+
+            // spawn tasks
+            detail::task_results<void> tasks(work.size());
+            detail::spawn_partitioned(work, work_helper, tasks, part);
+
+            // rethrow
+            stop.rethrow_errors(tasks);
+            return begin + best.load();
+        }
+
+        /**
+         * @brief searches the first element for which pred holds
+         */
+        template<typename Iter, typename predicate, typename partitioner>
+        Iter parallel_find_if_impl(Iter begin, Iter end, predicate pred, const partitioner& part) {
+            return parallel_search_impl(begin, end, [&pred] (Iter first, Iter last) {
+                return std::find_if(first, last, pred);
+            }, part);
         }
     }
 
     /**
-     * @brief searches val in range [begin, end)
-     * @return returns an iterator to one occurange of val, if the value was not found returns end
+     * @brief searches the first element of [begin, end) for which pred holds, like std::find_if
+     * @return returns an iterator to the first match, end if there is none
      */
-    template<typename Iter, typename T>
-    Iter parallel_find(Iter begin, Iter end, const T& val, int grainsize = 0) {
-        // get params work_piece_per_thread and grainsize
-        auto work_piece_per_thread = 0;
-        std::tie(grainsize, work_piece_per_thread) = detail::get_scheduler_params(end - begin, grainsize);
+    template<typename Iter, typename predicate>
+    Iter parallel_find_if(Iter begin, Iter end, predicate pred, int grainsize = 0) {
+        return detail::parallel_find_if_impl(begin, end, std::move(pred), simple_partitioner(grainsize));
+    }
 
-        if(work_piece_per_thread == 0) {
-            return end;
-        }
+    /**
+     * @brief parallel_find_if with a partitioner deciding how the range is cut into pieces
+     * @return returns an iterator to the first match, end if there is none
+     */
+    template<typename Iter, typename predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, Iter>::type
+    parallel_find_if(Iter begin, Iter end, predicate pred, const partitioner& part) {
+        return detail::parallel_find_if_impl(begin, end, std::move(pred), part);
+    }
 
-        // build work
-        std::atomic<bool> done(false);
-        auto work = detail::make_work(begin, end, work_piece_per_thread, grainsize);
-
-        // helper function which the threads will run
-        auto work_helper = [&] (detail::work_range<Iter>& work_rng) {
-            std::pair<Iter, Iter> work_chunk;
-            while(!done && work_rng.try_fetch_work(work_chunk, work)) {
-                auto found_iter = boost::find(work_chunk, val);
-                if(found_iter != work_chunk.second) {
-                    done = true;
-                    return found_iter;
-                }
-            }
+    /**
+     * @brief range wrapper for bam::parallel_find_if
+     */
+    template<typename Range, typename predicate>
+    auto parallel_find_if(Range&& rng, predicate pred, int grainsize = 0) -> decltype(boost::begin(rng)) {
+        return parallel_find_if(boost::begin(rng), boost::end(rng), std::move(pred), grainsize);
+    }
 
-            return end;
-        };
+    /**
+     * @brief range wrapper for bam::parallel_find_if with a partitioner
+     */
+    template<typename Range, typename predicate, typename partitioner>
+    auto parallel_find_if(Range&& rng, predicate pred, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, decltype(boost::begin(rng))>::type {
+        return parallel_find_if(boost::begin(rng), boost::end(rng), std::move(pred), part);
+    }
 
-        // spawn tasks
-        auto tasks = detail::spawn_tasks(work, work_helper);
+    /**
+     * @brief searches val in range [begin, end)
+     * @return returns an iterator to the first occurance of val like std::find, if the value was not found returns end
+     */
+    template<typename Iter, typename T>
+    Iter parallel_find(Iter begin, Iter end, const T& val, int grainsize = 0) {
+        return detail::parallel_find_if_impl(begin, end, detail::equal_to_value<T>{ val }, simple_partitioner(grainsize));
+    }
 
-        // get tasks & rethrow
-        return detail::join_iter(tasks, end);
+    /**
+     * @brief searches val in range [begin, end) with a partitioner deciding how the range is cut into pieces
+     * @return returns an iterator to the first occurance of val, if the value was not found returns end
+     */
+    template<typename Iter, typename T, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, Iter>::type
+    parallel_find(Iter begin, Iter end, const T& val, const partitioner& part) {
+        return detail::parallel_find_if_impl(begin, end, detail::equal_to_value<T>{ val }, part);
     }
 
     /**
      * @brief searches for val in rng 
-     * @return returns an iterator to one occurance of the searched value, if value was not found returns an end iterator of rng
+     * @return returns an iterator to the first occurance of the searched value, if value was not found returns an end iterator of rng
      */
     template<typename Range, typename T>
     auto parallel_find(Range&& rng, const T& val, int grainsize = 0) -> decltype(boost::begin(rng)) {
         return parallel_find(boost::begin(rng), boost::end(rng), val, grainsize);
     }
+
+    /**
+     * @brief searches for val in rng with a partitioner deciding how the range is cut into pieces
+     * @return returns an iterator to the first occurance of the searched value, if value was not found returns an end iterator of rng
+     */
+    template<typename Range, typename T, typename partitioner>
+    auto parallel_find(Range&& rng, const T& val, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, decltype(boost::begin(rng))>::type {
+        return parallel_find(boost::begin(rng), boost::end(rng), val, part);
+    }
 }
 
 #endif // BAM_PARALLEL_FIND_HPP
@@ -6,6 +6,7 @@
 #define BAM_PARALLEL_FOR_HPP
 
 #include "detail/parallel_utility.hpp"
+#include "partitioner.hpp"
 #include <iterator>
 
 #include <boost/range.hpp>
@@ -16,32 +17,49 @@
 
 namespace bam {
 
-    template<typename ra_iter, typename worker_predicate>
-    void parallel_for_impl(ra_iter begin, ra_iter end, worker_predicate worker, int grainsize = 0) {
-        // get params work_piece_per_thread and grainsize
-        auto work_piece_per_thread = 0;
-        std::tie(grainsize, work_piece_per_thread) = detail::get_scheduler_params(end - begin, grainsize);
-
-        if(work_piece_per_thread == 0) {
-            return;
-        }
-
-        // build work
-        auto work = detail::make_work(begin, end, work_piece_per_thread, grainsize);
-
-        // helper function which the threads will run
-        auto work_helper = [&work, worker] (detail::work_range<ra_iter>& work_rng) {
-            std::pair<ra_iter, ra_iter> work_chunk;
-            while(work_rng.try_fetch_work(work_chunk, work)) {
-                worker(work_chunk.first, work_chunk.second);
+    template<typename ra_iter, typename worker_predicate, typename partitioner>
+    void parallel_for_impl(ra_iter begin, ra_iter end, worker_predicate worker, const partitioner& part) {
+        detail::stop_state stop(part.get_cancellation_token(), part.collects_exceptions());
+
+        // the rest of the range, once it is found worth dispatching to the pool
+        auto dispatch = [&stop, worker, &part] (ra_iter begin, ra_iter end) {
+            // get params work_piece_per_thread and grainsize
+            auto grainsize = part.get_grainsize();
+            auto work_piece_per_thread = 0;
+            std::tie(grainsize, work_piece_per_thread) = detail::get_scheduler_params<typename detail::range_element<ra_iter>::type>(end - begin, grainsize);
+
+            if(work_piece_per_thread == 0) {
+                return;
             }
-        };
 
-        // spawn tasks
-        auto tasks = detail::spawn_tasks(work, work_helper);
+            // build work
+            detail::work_ranges<ra_iter> work;
+            detail::make_work(work, begin, end, work_piece_per_thread, grainsize, detail::get_claim_policy(part), part.get_grainsize() == 0);
+
+            // helper function which the threads will run, stops once a chunk threw
+            auto work_helper = [&work, &stop, worker] (detail::work_range<ra_iter>& work_rng) {
+                std::pair<ra_iter, ra_iter> work_chunk;
+                while(!stop.stop_requested() && work_rng.try_fetch_work(work_chunk, work)) {
+                    stop.run(worker, work_chunk.first, work_chunk.second);
+                }
+            };
+
+            // spawn tasks
+            detail::task_results<void> tasks(work.size());
+            detail::spawn_partitioned(work, work_helper, tasks, part);
 
-        // get tasks & rethrow
-        detail::get_tasks(tasks);
+            // rethrow
+            stop.rethrow_errors(tasks);
+        };
+
+        // small ranges are cheaper to run right here, the body doesn't care about the order of the pieces
+        auto run_probed = [&stop, worker] (ra_iter first, ra_iter last) {
+            if(!stop.stop_requested()) {
+                stop.run(worker, first, last);
+            }
+        };
+        detail::run_or_dispatch(begin, end, run_probed, dispatch, stop, part.get_cost_hint(), part.get_grainsize());
+        stop.get_token().throw_if_cancelled();
     }
 
     /**
@@ -53,7 +71,20 @@ namespace bam {
      */
     template<typename ra_iter, typename worker_predicate>
     void parallel_for(ra_iter begin, ra_iter end, worker_predicate worker, int grainsize = 0) {
-        parallel_for_impl(begin, end, std::move(worker), grainsize);
+        parallel_for_impl(begin, end, std::move(worker), simple_partitioner(grainsize));
+    }
+
+    /**
+     * \brief parallel_for with a partitioner deciding how the range is cut into pieces
+     * \param begin begin iterator of the range to be worked on
+     * \param end end iterator of the range to be worked on
+     * \param worker function object predicate which the threads will run to operate on the given range
+     * \param part partitioner, e.g. bam::auto_partitioner or bam::affinity_partitioner
+     */
+    template<typename ra_iter, typename worker_predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_for(ra_iter begin, ra_iter end, worker_predicate worker, const partitioner& part) {
+        parallel_for_impl(begin, end, std::move(worker), part);
     }
 
     /**
@@ -63,6 +94,15 @@ namespace bam {
     void parallel_for(range&& rng, worker_predicate worker, int grainsize = 0) {
         parallel_for(boost::begin(rng), boost::end(rng), std::move(worker), grainsize);
     }
+
+    /**
+     * \brief range wrapper for bam::parallel_for with a partitioner
+     */
+    template<typename range, typename worker_predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_for(range&& rng, worker_predicate worker, const partitioner& part) {
+        parallel_for(boost::begin(rng), boost::end(rng), std::move(worker), part);
+    }
 }
 
 #endif // bam_PARALLEL_FOR_HPP
@@ -34,6 +34,20 @@ namespace bam {
         parallel_for(begin, end, worker_helper, grainsize);
     }
 
+    /**
+     * \brief parallel_for_each with a partitioner deciding how the range is cut into pieces
+     * \param part partitioner, e.g. bam::auto_partitioner or bam::affinity_partitioner
+     */
+    template<typename ra_iter, typename worker_predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_for_each(ra_iter begin, ra_iter end, worker_predicate worker, const partitioner& part) {
+        auto worker_helper = [=] (ra_iter b, ra_iter e) {
+            std::for_each(b, e, worker);
+        };
+
+        parallel_for(begin, end, worker_helper, part);
+    }
+
     /**
      * @brief range wrapper for bam::parallel_for_each
      */
@@ -41,6 +55,15 @@ namespace bam {
     void parallel_for_each(range&& rng, worker_predicate worker, int grainsize = 0) {
         parallel_for_each(boost::begin(rng), boost::end(rng), std::move(worker), grainsize);
     }
+
+    /**
+     * @brief range wrapper for bam::parallel_for_each with a partitioner
+     */
+    template<typename range, typename worker_predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_for_each(range&& rng, worker_predicate worker, const partitioner& part) {
+        parallel_for_each(boost::begin(rng), boost::end(rng), std::move(worker), part);
+    }
 }
 
 
@@ -5,29 +5,42 @@
 #ifndef BAM_PARALLEL_INVOKE_HPP
 #define BAM_PARALLEL_INVOKE_HPP
 
+#include "cancellation.hpp"
+#include "detail/parallel_utility.hpp"
+
 #include <vector>
-#include <future>
+#include <functional>
 
 namespace bam {
     /**
-     * @brief invokes n functions in parallel; simple wrapper around some std::asyncs
+     * @brief parallel_invoke which skips the functions that haven't started once token is cancelled
+     * and then throws bam::operation_cancelled
+     */
+    template<typename ... Fs>
+    void parallel_invoke(const cancellation_token& token, Fs ...fs) {
+        std::vector<std::function<void()>> v_foos { fs ... };
+
+        // functions which haven't started are skipped once one threw
+        detail::stop_state stop(token, false);
+        auto invoker = [&stop] (std::function<void()>& foo) {
+            if(!stop.stop_requested()) {
+                stop.run(foo);
+            }
+        };
+        detail::task_results<void> tasks(v_foos.size());
+        detail::spawn_tasks(v_foos, invoker, tasks);
+
+        stop.rethrow_errors(tasks);
+    }
+
+    /**
+     * @brief invokes n functions in parallel on the worker pool
      * @tparam Fs variadic template param
      * @param fs variadic function param, each representing a function
      */
     template<typename ... Fs>
     void parallel_invoke(Fs ...fs) {
-    
-        std::vector<std::function<void()>> v_foos { fs ... };
-  
-        std::vector<std::future<void>> temp_futs;
-  
-        for(auto&& i : v_foos) {
-            temp_futs.push_back(std::async(std::launch::async, i));
-        }
-  
-        for(auto&& i : temp_futs) {
-            i.get();
-        }
+        parallel_invoke(cancellation_token(), fs...);
     }
 }
 
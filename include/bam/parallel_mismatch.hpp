@@ -0,0 +1,109 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// parallel_mismatch and parallel_equal, the first difference ends the scan of all threads
+
+#ifndef BAM_PARALLEL_MISMATCH_HPP
+#define BAM_PARALLEL_MISMATCH_HPP
+
+#include "parallel_adjacent_find.hpp"
+#include "parallel_find.hpp"
+#include "partitioner.hpp"
+
+#include <boost/range.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+namespace bam {
+    namespace detail {
+        template<typename Iter1, typename Iter2, typename binary_predicate, typename partitioner>
+        std::pair<Iter1, Iter2> parallel_mismatch_impl(Iter1 begin1, Iter1 end1, Iter2 begin2, binary_predicate pred, const partitioner& part) {
+            auto found = parallel_search_impl(begin1, end1, [&] (Iter1 first, Iter1 last) -> Iter1 {
+                auto other = begin2 + (first - begin1);
+                for(auto it = first; it != last; ++it, ++other) {
+                    if(!pred(*it, *other)) {
+                        return it;
+                    }
+                }
+                return last;
+            }, part);
+            return std::make_pair(found, begin2 + (found - begin1));
+        }
+    }
+
+    /**
+     * \brief searches the first position at which [begin1, end1) and the range starting at begin2 differ,
+     * like std::mismatch; both ranges have to be random access
+     * \return iterators to the first differing elements, end1 and its counterpart if there are none
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename Iter1, typename Iter2, typename binary_predicate>
+    std::pair<Iter1, Iter2> parallel_mismatch(Iter1 begin1, Iter1 end1, Iter2 begin2, binary_predicate pred, int grainsize = 0) {
+        return detail::parallel_mismatch_impl(begin1, end1, begin2, std::move(pred), simple_partitioner(grainsize));
+    }
+
+    /**
+     * \brief parallel_mismatch with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename Iter1, typename Iter2, typename binary_predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, std::pair<Iter1, Iter2>>::type
+    parallel_mismatch(Iter1 begin1, Iter1 end1, Iter2 begin2, binary_predicate pred, const partitioner& part) {
+        return detail::parallel_mismatch_impl(begin1, end1, begin2, std::move(pred), part);
+    }
+
+    /**
+     * \brief parallel_mismatch comparing with ==
+     */
+    template<typename Iter1, typename Iter2>
+    std::pair<Iter1, Iter2> parallel_mismatch(Iter1 begin1, Iter1 end1, Iter2 begin2) {
+        return parallel_mismatch(begin1, end1, begin2, detail::equal_elements());
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_mismatch, compares up to the end of the shorter range
+     */
+    template<typename Range1, typename Range2>
+    auto parallel_mismatch(Range1&& rng1, Range2&& rng2) -> std::pair<decltype(boost::begin(rng1)), decltype(boost::begin(rng2))> {
+        auto size = std::min<std::ptrdiff_t>(boost::size(rng1), boost::size(rng2));
+        return parallel_mismatch(boost::begin(rng1), boost::begin(rng1) + size, boost::begin(rng2));
+    }
+
+    /**
+     * \brief checks whether [begin1, end1) and the range starting at begin2 are equal, like std::equal
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename Iter1, typename Iter2, typename binary_predicate>
+    bool parallel_equal(Iter1 begin1, Iter1 end1, Iter2 begin2, binary_predicate pred, int grainsize = 0) {
+        return parallel_mismatch(begin1, end1, begin2, std::move(pred), grainsize).first == end1;
+    }
+
+    /**
+     * \brief parallel_equal with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename Iter1, typename Iter2, typename binary_predicate, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, bool>::type
+    parallel_equal(Iter1 begin1, Iter1 end1, Iter2 begin2, binary_predicate pred, const partitioner& part) {
+        return parallel_mismatch(begin1, end1, begin2, std::move(pred), part).first == end1;
+    }
+
+    /**
+     * \brief parallel_equal comparing with ==
+     */
+    template<typename Iter1, typename Iter2>
+    bool parallel_equal(Iter1 begin1, Iter1 end1, Iter2 begin2) {
+        return parallel_mismatch(begin1, end1, begin2).first == end1;
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_equal, ranges of different size are never equal
+     */
+    template<typename Range1, typename Range2>
+    auto parallel_equal(Range1&& rng1, Range2&& rng2) -> decltype(boost::begin(rng1), boost::begin(rng2), true) {
+        return boost::size(rng1) == boost::size(rng2) && parallel_equal(boost::begin(rng1), boost::end(rng1), boost::begin(rng2));
+    }
+}
+
+#endif // BAM_PARALLEL_MISMATCH_HPP
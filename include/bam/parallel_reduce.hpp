@@ -6,12 +6,101 @@
 #define BAM_PARALLEL_REDUCE_HPP
 
 #include "detail/parallel_utility.hpp"
+#include "partitioner.hpp"
 #include <iterator>
 
 #include <boost/range.hpp>
 
 namespace bam {
 
+    namespace detail {
+        template<typename ra_iter, typename worker_predicate, typename join_predicate, typename partitioner>
+        auto parallel_reduce_impl(ra_iter begin, ra_iter end, worker_predicate worker, join_predicate joiner, const partitioner& part) ->
+          typename std::result_of<
+              join_predicate(typename std::result_of<worker_predicate(ra_iter, ra_iter)>::type, typename std::result_of<worker_predicate(ra_iter, ra_iter)>::type)
+            >::type
+        {
+            typedef typename std::result_of<worker_predicate(ra_iter, ra_iter)>::type worker_return_type;
+            typedef typename std::result_of<join_predicate(worker_return_type, worker_return_type)>::type return_type;
+
+            detail::stop_state stop(part.get_cancellation_token(), part.collects_exceptions());
+            stop.get_token().throw_if_cancelled();
+
+            if(!(begin < end)) {
+                return worker(begin, end);
+            }
+
+            // small ranges are cheaper to run right here, the front which was run is joined in first
+            return_type front = return_type();
+            bool have_front = false;
+            auto run_front = [&] (ra_iter first, ra_iter last) {
+                if(stop.stop_requested()) {
+                    return;
+                }
+                if(have_front) {
+                    front = joiner(front, stop.run(worker, first, last));
+                }
+                else {
+                    front = stop.run(worker, first, last);
+                    have_front = true;
+                }
+            };
+            if(detail::run_below_cutoff(begin, end, run_front, part.get_cost_hint(), part.get_grainsize())) {
+                stop.get_token().throw_if_cancelled();
+                return front;
+            }
+
+            // get params work_piece_per_thread and grainsize
+            auto grainsize = part.get_grainsize();
+            auto work_piece_per_thread = 0;
+            std::tie(grainsize, work_piece_per_thread) = detail::get_scheduler_params<typename detail::range_element<ra_iter>::type>(end - begin, grainsize);
+
+            if(work_piece_per_thread == 0) {
+                if(have_front) {
+                    return joiner(front, stop.run(worker, begin, end));
+                }
+                return stop.run(worker, begin, end);
+            }
+
+            // create work
+            detail::work_ranges<ra_iter> work;
+            detail::make_work(work, begin, end, work_piece_per_thread, grainsize, get_claim_policy(part), part.get_grainsize() == 0);
+
+            // helper function, stops once a chunk threw
+            auto work_helper = [&work, &stop, worker, joiner] (detail::work_range<ra_iter>& work_rng) -> return_type {
+                return_type ret = return_type();
+                std::pair<ra_iter, ra_iter> work_chunk;
+
+                if(!stop.stop_requested() && work_rng.try_fetch_work(work_chunk, work)) { // first run initializes ret
+                  ret = stop.run(worker, work_chunk.first, work_chunk.second);
+                }
+
+                while(!stop.stop_requested() && work_rng.try_fetch_work(work_chunk, work)) {
+                  auto result = stop.run(worker, work_chunk.first, work_chunk.second);
+                  ret = joiner(ret, result);
+                }
+
+                return ret;
+            };
+
+            // start runner tasks
+            detail::task_results<return_type> threads(work.size());
+            detail::spawn_partitioned(work, work_helper, threads, part);
+
+            // rethrow, a stopped call has no result
+            stop.rethrow_errors(threads);
+            auto result = std::begin(threads)->get();
+            if(have_front) {
+                result = joiner(front, result);
+            }
+            for(auto it = std::begin(threads) + 1; it != std::end(threads); ++it) {
+                result = joiner(result, it->get());
+            }
+
+            return result;
+        }
+    }
+
     /**
      * \brief parallel_reduce algorithm, which enables parallelism on reduce opeartions
      * \param begin begin iterator of the range to be worked on
@@ -26,47 +115,20 @@ namespace bam {
           join_predicate(typename std::result_of<worker_predicate(ra_iter, ra_iter)>::type, typename std::result_of<worker_predicate(ra_iter, ra_iter)>::type)
         >::type
     {
-        typedef typename std::result_of<worker_predicate(ra_iter, ra_iter)>::type worker_return_type;
-        typedef typename std::result_of<join_predicate(worker_return_type, worker_return_type)>::type return_type;
-
-        // get params work_piece_per_thread and grainsize
-        auto work_piece_per_thread = 0;
-        std::tie(grainsize, work_piece_per_thread) = detail::get_scheduler_params(end - begin, grainsize);
-
-        if(work_piece_per_thread == 0) {
-            return worker(begin, end);
-        }
-
-        // create work
-        auto work = detail::make_work(begin, end, work_piece_per_thread, grainsize);
-
-        // helper function
-        auto work_helper = [&work, worker, joiner] (detail::work_range<ra_iter>& work_rng) -> return_type {
-            return_type ret = return_type();
-            std::pair<ra_iter, ra_iter> work_chunk;
-
-            if(work_rng.try_fetch_work(work_chunk, work)) { // first run initializes ret
-              ret = worker(work_chunk.first, work_chunk.second);
-            }
-
-            while(work_rng.try_fetch_work(work_chunk, work)) {
-              auto result = worker(work_chunk.first, work_chunk.second);
-              ret = joiner(ret, result);
-            }
-
-            return ret;
-        };
-
-        // start runner tasks
-        auto threads = detail::spawn_tasks(work, work_helper);
-
-        // join results
-        auto result = std::begin(threads)->get();
-        for(auto it = std::begin(threads) + 1; it != std::end(threads); ++it) {
-            result = joiner(result, it->get());
-        }
+        return detail::parallel_reduce_impl(begin, end, std::move(worker), std::move(joiner), simple_partitioner(grainsize));
+    }
 
-        return result;
+    /**
+     * \brief parallel_reduce with a partitioner deciding how the range is cut into pieces
+     * \param part partitioner, e.g. bam::auto_partitioner or bam::affinity_partitioner
+     */
+    template<typename ra_iter, typename worker_predicate, typename join_predicate, typename partitioner>
+    auto parallel_reduce(ra_iter begin, ra_iter end, worker_predicate worker, join_predicate joiner, const partitioner& part) ->
+      typename detail::enable_if_partitioner<partitioner, typename std::result_of<
+          join_predicate(typename std::result_of<worker_predicate(ra_iter, ra_iter)>::type, typename std::result_of<worker_predicate(ra_iter, ra_iter)>::type)
+        >::type>::type
+    {
+        return detail::parallel_reduce_impl(begin, end, std::move(worker), std::move(joiner), part);
     }
 
     /**
@@ -81,5 +143,18 @@ namespace bam {
     {
         return parallel_reduce(boost::begin(rng), boost::end(rng), std::move(worker), std::move(joiner), grainsize);
     }
+
+    /**
+     * \brief range wrapper for bam::parallel_reduce with a partitioner
+     */
+    template<typename range, typename worker_predicate, typename joiner_predicate, typename partitioner>
+    auto parallel_reduce(range& rng, worker_predicate worker, joiner_predicate joiner, const partitioner& part) ->
+        typename detail::enable_if_partitioner<partitioner, typename std::result_of<joiner_predicate(
+                    typename std::result_of<worker_predicate(typename range::iterator, typename range::iterator)>::type,
+                    typename std::result_of<worker_predicate(typename range::iterator, typename range::iterator)>::type
+                )>::type>::type
+    {
+        return parallel_reduce(boost::begin(rng), boost::end(rng), std::move(worker), std::move(joiner), part);
+    }
 }
 #endif // bam_PARALLEL_REDUCE_HPP
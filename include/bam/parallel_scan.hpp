@@ -0,0 +1,401 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// prefix sums: parallel_inclusive_scan, parallel_exclusive_scan and parallel_segmented_inclusive_scan
+
+#ifndef BAM_PARALLEL_SCAN_HPP
+#define BAM_PARALLEL_SCAN_HPP
+
+#include "detail/parallel_utility.hpp"
+#include "partitioner.hpp"
+
+#include <boost/optional.hpp>
+#include <boost/range.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+
+namespace bam {
+    namespace detail {
+        //! positions [first, last) of one block of a scan and the index of its summary
+        struct scan_block {
+            std::ptrdiff_t first;
+            std::ptrdiff_t last;
+            std::size_t index;
+        };
+
+        /**
+         * @brief two pass scan over the positions [0, size): the range is cut into at most one block per thread,
+         * the blocks are reduced to one summary each, the summaries are scanned right here, then every block is
+         * scanned starting from the summary of everything in front of it. The second pass replays the block to
+         * worker mapping of the first one, such that each block is likely still in the cache of the thread which
+         * reduced it. With a grainsize, blocks consist of whole grainsize pieces and reduce and scan are called on
+         * one piece at a time. Summaries are only copied from what reduce, combine and scan return, so they need no
+         * default constructor.
+         * @param reduce returns the summary of the positions [first, last)
+         * @param combine returns the summary of two neighbouring pieces, the front one first
+         * @param scan scans [first, last) starting from carry, nullptr if nothing comes before, and returns the
+         * summary of everything up to last
+         * @param init summary of what comes before position 0, nullptr if there is nothing
+         */
+        template<typename summary, typename reduce_op, typename combine_op, typename scan_op, typename partitioner>
+        void parallel_scan_impl(std::ptrdiff_t size, reduce_op reduce, combine_op combine, scan_op scan, const summary* init, const partitioner& part) {
+            detail::stop_state stop(part.get_cancellation_token(), part.collects_exceptions());
+            stop.get_token().throw_if_cancelled();
+
+            // small ranges are cheaper to scan right here, the rest continues from the front
+            boost::optional<summary> front;
+            if(init) {
+                front = *init;
+            }
+            auto run_front = [&] (std::ptrdiff_t first, std::ptrdiff_t last) {
+                if(stop.stop_requested()) {
+                    return;
+                }
+                front = stop.run(scan, first, last, front ? &*front : nullptr);
+            };
+            std::ptrdiff_t begin = 0;
+            if(detail::run_below_cutoff(begin, size, run_front, part.get_cost_hint(), part.get_grainsize())) {
+                stop.get_token().throw_if_cancelled();
+                return;
+            }
+
+            // at most one block per thread, cut on the grid of the asked grainsize, such that the jobs stay short
+            // whatever the grainsize; the operators are called on the grainsize pieces within a block
+            auto rest = size - begin;
+            std::ptrdiff_t grainsize = part.get_grainsize();
+            std::ptrdiff_t unit = grainsize > 0 ? grainsize : 1;
+            std::ptrdiff_t piece = grainsize > 0 ? grainsize : rest;
+            std::ptrdiff_t unit_count = (rest + unit - 1) / unit;
+            std::ptrdiff_t block_count = std::min<std::ptrdiff_t>(unit_count, detail::get_threadcount());
+            piece_vector<scan_block> blocks;
+            blocks.reserve(block_count);
+            for(std::ptrdiff_t i = 0; i != block_count; ++i) {
+                auto first = begin + unit_count * i / block_count * unit;
+                auto last = std::min(begin + unit_count * (i + 1) / block_count * unit, size);
+                blocks.emplace_back(scan_block{ first, last, static_cast<std::size_t>(i) });
+            }
+
+            // pass one, nothing follows the last block so it isn't reduced
+            piece_vector<boost::optional<summary>> sums(block_count);
+            auto reduce_helper = [&stop, &sums, reduce, combine, piece, &blocks] (scan_block& block) {
+                if(block.index + 1 == blocks.size()) {
+                    return;
+                }
+                auto& sum = sums[block.index];
+                for(auto first = block.first; first < block.last && !stop.stop_requested(); first += piece) {
+                    auto piece_sum = stop.run(reduce, first, std::min(first + piece, block.last));
+                    if(sum) {
+                        sum = stop.run(combine, *sum, piece_sum);
+                    }
+                    else {
+                        sum = std::move(piece_sum);
+                    }
+                }
+            };
+            affinity_record own_record;
+            auto& record = affinity_record_of(part, own_record);
+            detail::task_results<void> reduced(block_count);
+            detail::spawn_affine_tasks(blocks, reduce_helper, reduced, record);
+            stop.rethrow_errors(reduced);
+
+            // sums[i] becomes the summary of everything in front of block i, none if nothing is
+            for(auto i = 0u; i + 1 != blocks.size(); ++i) {
+                auto block_sum = std::move(*sums[i]);
+                sums[i] = front;
+                if(front) {
+                    front = combine(*front, block_sum);
+                }
+                else {
+                    front = std::move(block_sum);
+                }
+            }
+            sums[blocks.size() - 1] = std::move(front);
+
+            // pass two, each piece continues from the one in front of it
+            auto scan_helper = [&stop, &sums, scan, piece] (scan_block& block) {
+                auto& carry = sums[block.index];
+                for(auto first = block.first; first < block.last && !stop.stop_requested(); first += piece) {
+                    carry = stop.run(scan, first, std::min(first + piece, block.last), carry ? &*carry : nullptr);
+                }
+            };
+            detail::task_results<void> scanned(block_count);
+            detail::spawn_affine_tasks(blocks, scan_helper, scanned, record);
+            stop.rethrow_errors(scanned);
+        }
+
+        template<typename in_iter, typename out_iter, typename binary_op, typename partitioner>
+        out_iter parallel_inclusive_scan_impl(in_iter begin, in_iter end, out_iter out, binary_op op, const partitioner& part) {
+            typedef typename std::iterator_traits<in_iter>::value_type value_type;
+
+            auto reduce = [begin, op] (std::ptrdiff_t first, std::ptrdiff_t last) -> value_type {
+                value_type sum = begin[first];
+                for(auto i = first + 1; i != last; ++i) {
+                    sum = op(sum, begin[i]);
+                }
+                return sum;
+            };
+            auto scan = [begin, out, op] (std::ptrdiff_t first, std::ptrdiff_t last, const value_type* carry) -> value_type {
+                value_type sum = carry ? op(*carry, begin[first]) : value_type(begin[first]);
+                out[first] = sum;
+                for(auto i = first + 1; i != last; ++i) {
+                    sum = op(sum, begin[i]);
+                    out[i] = sum;
+                }
+                return sum;
+            };
+            parallel_scan_impl<value_type>(end - begin, reduce, op, scan, nullptr, part);
+            return out + (end - begin);
+        }
+
+        template<typename in_iter, typename out_iter, typename T, typename binary_op, typename partitioner>
+        out_iter parallel_exclusive_scan_impl(in_iter begin, in_iter end, out_iter out, T init, binary_op op, const partitioner& part) {
+            auto reduce = [begin, op] (std::ptrdiff_t first, std::ptrdiff_t last) -> T {
+                T sum = begin[first];
+                for(auto i = first + 1; i != last; ++i) {
+                    sum = op(sum, begin[i]);
+                }
+                return sum;
+            };
+            // the carry includes init, read each element before its slot is written for in place scans
+            auto scan = [begin, out, op] (std::ptrdiff_t first, std::ptrdiff_t last, const T* carry) -> T {
+                T sum = *carry;
+                for(auto i = first; i != last; ++i) {
+                    T next = op(sum, begin[i]);
+                    out[i] = sum;
+                    sum = next;
+                }
+                return sum;
+            };
+            parallel_scan_impl<T>(end - begin, reduce, op, scan, &init, part);
+            return out + (end - begin);
+        }
+
+        //! running value of a segmented scan and whether a segment starts in the piece it summarises
+        template<typename T>
+        struct segment_summary {
+            T value;
+            bool head;
+        };
+
+        template<typename in_iter, typename flag_iter, typename out_iter, typename binary_op, typename partitioner>
+        out_iter parallel_segmented_inclusive_scan_impl(in_iter begin, in_iter end, flag_iter flags, out_iter out, binary_op op, const partitioner& part) {
+            typedef typename std::iterator_traits<in_iter>::value_type value_type;
+            typedef segment_summary<value_type> summary;
+
+            auto reduce = [begin, flags, op] (std::ptrdiff_t first, std::ptrdiff_t last) -> summary {
+                summary sum{ begin[first], static_cast<bool>(flags[first]) };
+                for(auto i = first + 1; i != last; ++i) {
+                    if(flags[i]) {
+                        sum.value = begin[i];
+                        sum.head = true;
+                    }
+                    else {
+                        sum.value = op(sum.value, begin[i]);
+                    }
+                }
+                return sum;
+            };
+            // a head in the back piece cuts off everything in front of it
+            auto combine = [op] (const summary& front, const summary& back) -> summary {
+                return back.head ? back : summary{ op(front.value, back.value), front.head };
+            };
+            auto scan = [begin, flags, out, op] (std::ptrdiff_t first, std::ptrdiff_t last, const summary* carry) -> summary {
+                summary sum{ begin[first], (carry && carry->head) || static_cast<bool>(flags[first]) };
+                if(carry && !flags[first]) {
+                    sum.value = op(carry->value, sum.value);
+                }
+                out[first] = sum.value;
+                for(auto i = first + 1; i != last; ++i) {
+                    if(flags[i]) {
+                        sum.value = begin[i];
+                        sum.head = true;
+                    }
+                    else {
+                        sum.value = op(sum.value, begin[i]);
+                    }
+                    out[i] = sum.value;
+                }
+                return sum;
+            };
+            parallel_scan_impl<summary>(end - begin, reduce, combine, scan, nullptr, part);
+            return out + (end - begin);
+        }
+    }
+
+    /**
+     * \brief parallel_inclusive_scan algorithm, replacing serial std::partial_sum; out[i] is the op-sum of
+     * begin[0] to begin[i]. The input is read twice, so the range has to be random access.
+     * \param out begin iterator of the output range, may be begin to scan in place
+     * \param op associative binary operation, need not be commutative
+     * \param grainsize size of the blocks, default argument of 0 means that grainsize will be determined on runtime
+     * \return end of the output range
+     */
+    template<typename in_iter, typename out_iter, typename binary_op>
+    out_iter parallel_inclusive_scan(in_iter begin, in_iter end, out_iter out, binary_op op, int grainsize = 0) {
+        return detail::parallel_inclusive_scan_impl(begin, end, out, std::move(op), simple_partitioner(grainsize));
+    }
+
+    /**
+     * \brief parallel_inclusive_scan with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename in_iter, typename out_iter, typename binary_op, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, out_iter>::type
+    parallel_inclusive_scan(in_iter begin, in_iter end, out_iter out, binary_op op, const partitioner& part) {
+        return detail::parallel_inclusive_scan_impl(begin, end, out, std::move(op), part);
+    }
+
+    /**
+     * \brief parallel_inclusive_scan summing with +
+     */
+    template<typename in_iter, typename out_iter>
+    out_iter parallel_inclusive_scan(in_iter begin, in_iter end, out_iter out) {
+        return parallel_inclusive_scan(begin, end, out, std::plus<typename std::iterator_traits<in_iter>::value_type>());
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_inclusive_scan
+     */
+    template<typename Range, typename out_iter, typename binary_op>
+    auto parallel_inclusive_scan(Range&& rng, out_iter out, binary_op op, int grainsize = 0)
+      -> typename std::decay<decltype(boost::begin(rng), out)>::type {
+        return parallel_inclusive_scan(boost::begin(rng), boost::end(rng), out, std::move(op), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_inclusive_scan with a partitioner
+     */
+    template<typename Range, typename out_iter, typename binary_op, typename partitioner>
+    auto parallel_inclusive_scan(Range&& rng, out_iter out, binary_op op, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, typename std::decay<decltype(boost::begin(rng), out)>::type>::type {
+        return parallel_inclusive_scan(boost::begin(rng), boost::end(rng), out, std::move(op), part);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_inclusive_scan summing with +
+     */
+    template<typename Range, typename out_iter>
+    auto parallel_inclusive_scan(Range&& rng, out_iter out) -> typename std::decay<decltype(boost::begin(rng), out)>::type {
+        return parallel_inclusive_scan(boost::begin(rng), boost::end(rng), out);
+    }
+
+    /**
+     * \brief parallel_exclusive_scan algorithm; out[0] is init and out[i] the op-sum of init and begin[0] to
+     * begin[i - 1]. The input is read twice, so the range has to be random access.
+     * \param out begin iterator of the output range, may be begin to scan in place
+     * \param op associative binary operation, need not be commutative
+     * \param grainsize size of the blocks, default argument of 0 means that grainsize will be determined on runtime
+     * \return end of the output range
+     */
+    template<typename in_iter, typename out_iter, typename T, typename binary_op>
+    out_iter parallel_exclusive_scan(in_iter begin, in_iter end, out_iter out, T init, binary_op op, int grainsize = 0) {
+        return detail::parallel_exclusive_scan_impl(begin, end, out, std::move(init), std::move(op), simple_partitioner(grainsize));
+    }
+
+    /**
+     * \brief parallel_exclusive_scan with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename in_iter, typename out_iter, typename T, typename binary_op, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, out_iter>::type
+    parallel_exclusive_scan(in_iter begin, in_iter end, out_iter out, T init, binary_op op, const partitioner& part) {
+        return detail::parallel_exclusive_scan_impl(begin, end, out, std::move(init), std::move(op), part);
+    }
+
+    /**
+     * \brief parallel_exclusive_scan summing with +
+     */
+    template<typename in_iter, typename out_iter, typename T>
+    out_iter parallel_exclusive_scan(in_iter begin, in_iter end, out_iter out, T init) {
+        return parallel_exclusive_scan(begin, end, out, std::move(init), std::plus<T>());
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_exclusive_scan
+     */
+    template<typename Range, typename out_iter, typename T, typename binary_op>
+    auto parallel_exclusive_scan(Range&& rng, out_iter out, T init, binary_op op, int grainsize = 0)
+      -> typename std::decay<decltype(boost::begin(rng), out)>::type {
+        return parallel_exclusive_scan(boost::begin(rng), boost::end(rng), out, std::move(init), std::move(op), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_exclusive_scan with a partitioner
+     */
+    template<typename Range, typename out_iter, typename T, typename binary_op, typename partitioner>
+    auto parallel_exclusive_scan(Range&& rng, out_iter out, T init, binary_op op, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, typename std::decay<decltype(boost::begin(rng), out)>::type>::type {
+        return parallel_exclusive_scan(boost::begin(rng), boost::end(rng), out, std::move(init), std::move(op), part);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_exclusive_scan summing with +
+     */
+    template<typename Range, typename out_iter, typename T>
+    auto parallel_exclusive_scan(Range&& rng, out_iter out, T init) -> typename std::decay<decltype(boost::begin(rng), out)>::type {
+        return parallel_exclusive_scan(boost::begin(rng), boost::end(rng), out, std::move(init));
+    }
+
+    /**
+     * \brief inclusive scan restarting at every element whose head flag is set, e.g. one prefix sum per row of a
+     * CSR matrix; the first element always starts a segment
+     * \param flags begin iterator of the head flags, one per element, convertible to bool
+     * \param out begin iterator of the output range, may be begin to scan in place
+     * \param op associative binary operation, need not be commutative
+     * \param grainsize size of the blocks, default argument of 0 means that grainsize will be determined on runtime
+     * \return end of the output range
+     */
+    template<typename in_iter, typename flag_iter, typename out_iter, typename binary_op>
+    out_iter parallel_segmented_inclusive_scan(in_iter begin, in_iter end, flag_iter flags, out_iter out, binary_op op, int grainsize = 0) {
+        return detail::parallel_segmented_inclusive_scan_impl(begin, end, flags, out, std::move(op), simple_partitioner(grainsize));
+    }
+
+    /**
+     * \brief parallel_segmented_inclusive_scan with a partitioner deciding how the range is cut into pieces
+     */
+    template<typename in_iter, typename flag_iter, typename out_iter, typename binary_op, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner, out_iter>::type
+    parallel_segmented_inclusive_scan(in_iter begin, in_iter end, flag_iter flags, out_iter out, binary_op op, const partitioner& part) {
+        return detail::parallel_segmented_inclusive_scan_impl(begin, end, flags, out, std::move(op), part);
+    }
+
+    /**
+     * \brief parallel_segmented_inclusive_scan summing with +
+     */
+    template<typename in_iter, typename flag_iter, typename out_iter>
+    out_iter parallel_segmented_inclusive_scan(in_iter begin, in_iter end, flag_iter flags, out_iter out) {
+        return parallel_segmented_inclusive_scan(begin, end, flags, out, std::plus<typename std::iterator_traits<in_iter>::value_type>());
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_segmented_inclusive_scan
+     */
+    template<typename Range, typename flag_iter, typename out_iter, typename binary_op>
+    auto parallel_segmented_inclusive_scan(Range&& rng, flag_iter flags, out_iter out, binary_op op, int grainsize = 0)
+      -> typename std::decay<decltype(boost::begin(rng), out)>::type {
+        return parallel_segmented_inclusive_scan(boost::begin(rng), boost::end(rng), flags, out, std::move(op), grainsize);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_segmented_inclusive_scan with a partitioner
+     */
+    template<typename Range, typename flag_iter, typename out_iter, typename binary_op, typename partitioner>
+    auto parallel_segmented_inclusive_scan(Range&& rng, flag_iter flags, out_iter out, binary_op op, const partitioner& part)
+      -> typename detail::enable_if_partitioner<partitioner, typename std::decay<decltype(boost::begin(rng), out)>::type>::type {
+        return parallel_segmented_inclusive_scan(boost::begin(rng), boost::end(rng), flags, out, std::move(op), part);
+    }
+
+    /**
+     * \brief range wrapper for bam::parallel_segmented_inclusive_scan summing with +
+     */
+    template<typename Range, typename flag_iter, typename out_iter>
+    auto parallel_segmented_inclusive_scan(Range&& rng, flag_iter flags, out_iter out)
+      -> typename std::decay<decltype(boost::begin(rng), out)>::type {
+        return parallel_segmented_inclusive_scan(boost::begin(rng), boost::end(rng), flags, out);
+    }
+}
+
+#endif // BAM_PARALLEL_SCAN_HPP
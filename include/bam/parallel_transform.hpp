@@ -15,15 +15,12 @@
 namespace bam {
 
     /**
-     * \brief parallel_transform algorithm, replacing serial std::transform
-     * \param input_begin begin iterator of the range to be worked on
-     * \param input_end end iterator of the range to be worked on
-     * \param out_first begin iterator of the range where the mapped values will be written to
-     * \param worker function object predicate which the threads will run to operate on the given range
-     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     * \brief parallel_transform with a partitioner deciding how the range is cut into pieces
+     * \param part partitioner, e.g. bam::auto_partitioner or one carrying a cancellation_token
      */
-    template<typename in_iter, typename out_iter, typename Worker>
-    void parallel_transform(in_iter input_first, in_iter input_end, out_iter out_first, Worker worker, int grainsize = 0) {
+    template<typename in_iter, typename out_iter, typename Worker, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_transform(in_iter input_first, in_iter input_end, out_iter out_first, Worker worker, const partitioner& part) {
         using in_type = typename std::iterator_traits<in_iter>::value_type;
         using out_type = typename std::iterator_traits<out_iter>::value_type;
 
@@ -35,7 +32,20 @@ namespace bam {
         auto end = boost::make_zip_iterator(boost::make_tuple(input_end,
             out_first + std::distance(input_first, input_end)));
 
-        bam::parallel_for_each(begin, end, helper, grainsize);
+        bam::parallel_for_each(begin, end, helper, part);
+    }
+
+    /**
+     * \brief parallel_transform algorithm, replacing serial std::transform
+     * \param input_begin begin iterator of the range to be worked on
+     * \param input_end end iterator of the range to be worked on
+     * \param out_first begin iterator of the range where the mapped values will be written to
+     * \param worker function object predicate which the threads will run to operate on the given range
+     * \param grainsize defines the grainsize, default argument of 0 means that grainsize will be determined on runtime
+     */
+    template<typename in_iter, typename out_iter, typename Worker>
+    void parallel_transform(in_iter input_first, in_iter input_end, out_iter out_first, Worker worker, int grainsize = 0) {
+        bam::parallel_transform(input_first, input_end, out_first, std::move(worker), simple_partitioner(grainsize));
     }
 
     /**
@@ -45,6 +55,15 @@ namespace bam {
     void parallel_transform(in_range&& input_range, out_iter out_first, Worker worker) {
         bam::parallel_transform(boost::begin(input_range), boost::end(input_range), out_first, std::move(worker));
     }
+
+    /**
+     * @brief range wrapper for bam::parallel_transform with a partitioner
+     */
+    template<typename in_range, typename out_iter, typename Worker, typename partitioner>
+    typename detail::enable_if_partitioner<partitioner>::type
+    parallel_transform(in_range&& input_range, out_iter out_first, Worker worker, const partitioner& part) {
+        bam::parallel_transform(boost::begin(input_range), boost::end(input_range), out_first, std::move(worker), part);
+    }
 }
 
 #endif
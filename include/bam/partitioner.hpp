@@ -0,0 +1,191 @@
+// (C) Copyright Stephan Dollberg 2012-2013. Distributed under the Boost
+// Software License, Version 1.0. (See accompanying file
+// LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+// partitioners, decide how parallel_ constructs cut their range into pieces
+
+#ifndef BAM_PARTITIONER_HPP
+#define BAM_PARTITIONER_HPP
+
+#include "cancellation.hpp"
+#include "detail/parallel_utility.hpp"
+#include "detail/work_range.hpp"
+
+#include <chrono>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace bam {
+
+    // forward declaration needed for friend
+    namespace detail {
+        struct partitioner_access;
+
+        /**
+         * @brief what every partitioner offers besides the way it cuts the range
+         */
+        template<typename Derived>
+        class partitioner_base {
+        public:
+            partitioner_base() : element_cost(0), collect(false) {}
+
+            /**
+             * @brief estimated time the worker needs per element; calls whose total estimate is below what
+             * dispatching to the worker pool costs run on the calling thread, without a hint the first
+             * elements are timed to find out
+             */
+            Derived& cost_hint(std::chrono::nanoseconds per_element) {
+                element_cost = per_element;
+                return static_cast<Derived&>(*this);
+            }
+
+            std::chrono::nanoseconds get_cost_hint() const {
+                return element_cost;
+            }
+
+            /**
+             * @brief once token is cancelled, chunks which haven't started yet are skipped and the call throws
+             * bam::operation_cancelled
+             */
+            Derived& cancel_with(cancellation_token token_) {
+                token = std::move(token_);
+                return static_cast<Derived&>(*this);
+            }
+
+            const cancellation_token& get_cancellation_token() const {
+                return token;
+            }
+
+            /**
+             * @brief the first exception of a chunk stops the call either way; with collect set, the exceptions
+             * of all chunks which were running by then are thrown together as bam::aggregate_exception
+             */
+            Derived& collect_exceptions(bool collect_ = true) {
+                collect = collect_;
+                return static_cast<Derived&>(*this);
+            }
+
+            bool collects_exceptions() const {
+                return collect;
+            }
+
+        private:
+            std::chrono::nanoseconds element_cost;
+            cancellation_token token;
+            bool collect;
+        };
+    }
+
+    /**
+     * @brief cuts the range into chunks of a fixed grainsize and hands them out one by one; this is
+     * what the parallel_ constructs taking an int grainsize do
+     */
+    class simple_partitioner : public detail::partitioner_base<simple_partitioner> {
+    public:
+        /**
+         * @param grainsize_ size of one chunk, 0 means that the grainsize will be determined on runtime
+         */
+        explicit simple_partitioner(int grainsize_ = 0) : grainsize(grainsize_) {}
+
+        int get_grainsize() const {
+            return grainsize;
+        }
+
+    private:
+        int grainsize;
+    };
+
+    /**
+     * @brief lets each thread work on growing contiguous pieces of its part of the range as long as
+     * no other thread runs out of work; once one steals, the pieces start small again
+     */
+    class auto_partitioner : public detail::partitioner_base<auto_partitioner> {
+    public:
+        int get_grainsize() const {
+            return 0;
+        }
+    };
+
+    /**
+     * @brief remembers which worker ran which piece of the range and hands the same pieces to the same
+     * workers in the next call, such that repeated loops over the same data find it in warm caches;
+     * pass the same object to every call, it must not be used by two calls at the same time
+     */
+    class affinity_partitioner : public detail::partitioner_base<affinity_partitioner> {
+    public:
+        int get_grainsize() const {
+            return 0;
+        }
+
+    private:
+        mutable detail::affinity_record last; // worker slot and numa node which ran each piece during the last call
+
+        friend struct detail::partitioner_access;
+    };
+
+    namespace detail {
+
+        template<typename T>
+        struct is_partitioner : std::false_type {};
+
+        template<>
+        struct is_partitioner<simple_partitioner> : std::true_type {};
+
+        template<>
+        struct is_partitioner<auto_partitioner> : std::true_type {};
+
+        template<>
+        struct is_partitioner<affinity_partitioner> : std::true_type {};
+
+        //! enables the partitioner overloads of the parallel_ constructs
+        template<typename partitioner, typename T = void>
+        struct enable_if_partitioner : std::enable_if<is_partitioner<typename std::decay<partitioner>::type>::value, T> {};
+
+        inline claim_policy get_claim_policy(const simple_partitioner&) {
+            return claim_policy::fixed;
+        }
+
+        inline claim_policy get_claim_policy(const auto_partitioner&) {
+            return claim_policy::adaptive;
+        }
+
+        inline claim_policy get_claim_policy(const affinity_partitioner&) {
+            return claim_policy::fixed;
+        }
+
+        /**
+         * @brief runs foo on every element of work the way the partitioner wants it
+         */
+        template<typename Work, typename worker_foo, typename Results, typename partitioner>
+        void spawn_partitioned(Work& work, worker_foo&& foo, Results& results, const partitioner&) {
+            spawn_tasks(work, std::forward<worker_foo>(foo), results);
+        }
+
+        struct partitioner_access {
+            static affinity_record& record(const affinity_partitioner& part) {
+                return part.last;
+            }
+        };
+
+        template<typename Work, typename worker_foo, typename Results>
+        void spawn_partitioned(Work& work, worker_foo&& foo, Results& results, const affinity_partitioner& part) {
+            spawn_affine_tasks(work, std::forward<worker_foo>(foo), results, partitioner_access::record(part));
+        }
+
+        /**
+         * @brief record for calls which replay their own passes with spawn_affine_tasks: the one of an
+         * affinity_partitioner, such that its next call replays this one, otherwise own
+         */
+        template<typename partitioner>
+        affinity_record& affinity_record_of(const partitioner&, affinity_record& own) {
+            return own;
+        }
+
+        inline affinity_record& affinity_record_of(const affinity_partitioner& part, affinity_record&) {
+            return partitioner_access::record(part);
+        }
+    }
+}
+
+#endif // BAM_PARTITIONER_HPP
@@ -5,10 +5,13 @@
 #ifndef BAM_TASK_POOL_HPP
 #define BAM_TASK_POOL_HPP
 
+#include "cancellation.hpp"
 #include "detail/work_pool.hpp"
 #include "detail/parallel_utility.hpp"
 #include "detail/function_wrapper.hpp"
-#include "detail/semaphore.hpp"
+#include "detail/event_count.hpp"
+#include "detail/topology.hpp"
+#include "future.hpp"
 
 #include <vector>
 #include <future>
@@ -24,18 +27,30 @@ namespace bam {
         class async_task_pool;
     }
 
+    /**
+     * @brief how idle task_pool workers wait for new tasks
+     */
+    enum class wait_strategy {
+        blocking,       //!< park right away, lowest cpu usage
+        spin_then_park, //!< poll for a while before parking, the default
+        busy_poll       //!< never park, for workers owning dedicated cores
+    };
+
     class task_pool {
     public:
-        task_pool() : sem(0), done(false), work(detail::get_threadcount()), threads(detail::get_threadcount()) {
-            init_impl();   
-        }
+        static const unsigned default_spin_count = 2000;
+
+        /**
+         * \brief creates the pool and starts its workers
+         * \param strategy how idle workers wait for new tasks
+         * \param spin_count number of failed polls before a worker parks, only used by spin_then_park
+         */
+        explicit task_pool(wait_strategy strategy = wait_strategy::spin_then_park, unsigned spin_count = default_spin_count) :
+            task_pool(strategy, spin_count, detail::concurrency_limit()) {}
 
         ~task_pool() {
             done = true;
-
-            for(auto i = 0u; i != threads.size(); ++i) {
-                sem.post();
-            }
+            events.notify_all();
         }
 
         /**
@@ -44,28 +59,58 @@ namespace bam {
          * \param args variadic argument to take the parameters for the function being added
          */
         template<typename function, typename ...Args>
-        std::future<typename std::result_of<function(Args...)>::type> add(function&& f, Args&& ...args) {
+        bam::future<typename std::result_of<function(Args...)>::type> add(function&& f, Args&& ...args) {
             assert(done == false);
-            typedef typename std::result_of<function(Args...)>::type return_type;
 
-            auto bound_task = std::bind(std::forward<function>(f), std::forward<Args>(args)...);
-            std::packaged_task<return_type()> task(std::move(bound_task));
-            auto ret = task.get_future();
+            auto task_and_future = detail::make_promised_task(std::forward<function>(f), std::forward<Args>(args)...);
+            auto& task = task_and_future.first;
+
+            pending.fetch_add(1);
+            auto& self = current_worker();
+            if(self.pool == this) {
+                work[self.id].push_local(std::move(task)); // tasks spawned by tasks stay with their worker
+            }
+            else {
+                work[submission_shard()].push_back(std::move(task));
+            }
 
-            work[0].push_back(std::move(task)); // profiling needed
-            
-            sem.post();
-            return ret;
+            events.notify_one(); // no syscall unless a worker is parked
+            return std::move(task_and_future.second);
         }
 
-        //! finish tasks and get ready for new ones
+        /**
+         * \brief adds a task which is skipped if token is cancelled before it starts; its future then
+         * holds bam::operation_cancelled
+         * \param token token to check before the task runs, the task itself may poll it too
+         */
+        template<typename function, typename ...Args>
+        bam::future<typename std::result_of<function(Args...)>::type> add(const cancellation_token& token, function&& f, Args&& ...args) {
+            return add(detail::make_cancellable(token, std::forward<function>(f)), std::forward<Args>(args)...);
+        }
+
+        /**
+         * \brief waits till all added tasks, including the ones they added, have finished; the workers
+         * stay alive and the calling thread helps running tasks meanwhile, must not be called from a task
+         */
         void wait() {
-            wait_impl();
+            assert(done == false);
+            assert(current_worker().pool != this);
 
-            // make task pool ready to work again after all work has been finished
-            done = false;
+            detail::function_wrapper task;
+            while(pending.load() != 0) {
+                if(detail::work_pool::try_steal_work(task, work)) {
+                    run_task(task);
+                    continue;
+                }
 
-            init_impl();
+                auto key = quiescent.prepare_wait();
+                if(pending.load() == 0) {
+                    quiescent.cancel_wait();
+                }
+                else {
+                    quiescent.wait(key);
+                }
+            }
         }
 
         //! finish tasks and don't restart threading
@@ -74,43 +119,140 @@ namespace bam {
         }
 
     private:
-        detail::semaphore sem;
+        //! starts thread_count workers, the public constructor passes bam::max_concurrency()
+        task_pool(wait_strategy strategy, unsigned spin_count, int thread_count) :
+            strategy(strategy), spin_count(spin_count), pinned(detail::pin_workers()), done(false), pending(0), work(thread_count), threads(thread_count) {
+            init_impl();
+        }
+
+        const wait_strategy strategy;
+        const unsigned spin_count;
+        const bool pinned; // workers are pinned and steal from the closest ones first
+        detail::event_count events;
         std::atomic<bool> done;
+        std::atomic<std::size_t> pending; // added tasks which haven't finished yet
+        detail::event_count quiescent; // notified when pending drops to zero
         std::vector<detail::work_pool> work;
         std::vector<std::future<void>> threads;
 
+        //! identifies the task_pool worker running on the current thread, if any
+        struct worker_identity {
+            task_pool* pool;
+            int id;
+        };
+
+        static worker_identity& current_worker() {
+            static thread_local worker_identity self = { nullptr, 0 };
+            return self;
+        }
+
+        /**
+         * @brief inbox used by the calling thread when it is not a worker of this pool; every producer
+         * thread gets its own shard assigned round robin, such that producers don't contend on one lock
+         */
+        int submission_shard() const {
+            static std::atomic<unsigned> next_producer(0);
+            static thread_local unsigned producer = next_producer++;
+            return producer % work.size();
+        }
+
         /**
          * @brief worker helper function the threads will run
          * @param thread_id thread_id which is used to map to the right work_pool
          */
         void worker(int thread_id) {
+            auto& self = current_worker();
+            self.pool = this;
+            self.id = thread_id;
+            if(pinned) {
+                detail::pin_current_thread(detail::worker_cpu(thread_id + 1).cpu);
+            }
+            detail::current_wait_helper() = { &task_pool::help_one, this };
+
             detail::function_wrapper task;
             while(!done) {
-                if(work[thread_id].try_fetch_work(task, work)) {
-                    task();
-                }
-                else {
-                    std::this_thread::yield();
-                    sem.wait();
+                if(work[thread_id].try_fetch_work(task, work) || idle_wait(thread_id, task)) {
+                    run_task(task);
                 }
             }
 
             // finish work
             while(work[thread_id].try_fetch_work(task, work)) {
-                task();
+                run_task(task);
+            }
+
+            self.pool = nullptr;
+            detail::current_wait_helper() = { nullptr, nullptr };
+        }
+
+        /**
+         * @brief runs one task of the pool on the current worker, used while a task waits for a future
+         * @param pool task_pool of the current worker
+         * @return true if a task was run
+         */
+        static bool help_one(void* pool) {
+            auto self = static_cast<task_pool*>(pool);
+            detail::function_wrapper task;
+            if(self->work[current_worker().id].try_fetch_work(task, self->work)) {
+                self->run_task(task);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * @brief runs a task which was counted in pending and wakes wait once the last one finished
+         * @param task task to run, promised tasks don't throw
+         */
+        void run_task(detail::function_wrapper& task) {
+            task();
+            if(pending.fetch_sub(1) == 1) {
+                quiescent.notify_all();
             }
         }
 
+        /**
+         * @brief waits for new work according to the wait strategy
+         * @param thread_id id of the waiting worker
+         * @param task function_wrapper which will be filled if work showed up while waiting
+         * @return true if task was filled, false if the worker should check for shutdown
+         */
+        bool idle_wait(int thread_id, detail::function_wrapper& task) {
+            if(strategy == wait_strategy::busy_poll) {
+                detail::cpu_relax();
+                return false;
+            }
+
+            if(strategy == wait_strategy::spin_then_park) {
+                for(auto i = 0u; i != spin_count && !done; ++i) {
+                    detail::cpu_relax();
+                    if(work[thread_id].try_fetch_work(task, work)) {
+                        return true;
+                    }
+                }
+            }
+
+            // tasks added after prepare_wait bump the epoch, so the final check can't miss them
+            auto key = events.prepare_wait();
+            if(done) {
+                events.cancel_wait();
+                return false;
+            }
+            if(work[thread_id].try_fetch_work(task, work)) {
+                events.cancel_wait();
+                return true;
+            }
+            events.wait(key);
+            return false;
+        }
+
         /**
          * @brief waits till all threads have finished
          */
         void wait_impl() {
             assert(done == false);
             done = true;
-
-            for(auto i = 0u; i != threads.size(); ++i) {
-                sem.post();
-            }
+            events.notify_all();
 
             for(auto& i : threads) {
                 i.get();
@@ -121,6 +263,16 @@ namespace bam {
          * @brief starts threads with worker func
          */
         void init_impl() {
+            if(pinned) {
+                std::vector<detail::cpu_info> cpus;
+                for(auto i = 0u; i != work.size(); ++i) {
+                    cpus.push_back(detail::worker_cpu(i + 1));
+                }
+                for(auto i = 0u; i != work.size(); ++i) {
+                    work[i].set_steal_levels(detail::steal_levels(cpus, i));
+                }
+            }
+
             try {
                 int thread_id = 0;
                 for(auto&& i: threads) {
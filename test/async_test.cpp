@@ -1,5 +1,6 @@
 #include "../include/bam/async.hpp"
 #include "catch.hpp"
+#include <memory>
 
 TEST_CASE("async/1", "testing basic async functionality") {
   auto fut = bam::async([] { return 42; });
@@ -7,10 +8,10 @@ TEST_CASE("async/1", "testing basic async functionality") {
 }
 
 TEST_CASE("async/2", "testing std::launch::async behaviour") {
-  std::atomic<int> var(0);
-  auto fut = bam::async([&] { while(!var) { std::this_thread::yield(); }});
-  var = 1;
-  CHECK(var.load() == 1);
+  auto var = std::make_shared<std::atomic<int>>(0); // the task may outlive this scope
+  auto fut = bam::async([=] { while(!*var) { std::this_thread::yield(); }});
+  *var = 1;
+  CHECK(var->load() == 1);
 }
 
 TEST_CASE("async/3", "testing std::launch::deferred behaviour") {
@@ -21,8 +22,8 @@ TEST_CASE("async/3", "testing std::launch::deferred behaviour") {
 }
 
 TEST_CASE("async/4", "testing unblocking behaviour on std::launch::async") {
-  std::atomic<int> var(0);
-  bam::async([&] { while(!var) { std::this_thread::yield(); }});
-  var = 1;
-  CHECK(var.load() == 1);
+  auto var = std::make_shared<std::atomic<int>>(0); // the task may outlive this scope
+  bam::async([=] { while(!*var) { std::this_thread::yield(); }});
+  *var = 1;
+  CHECK(var->load() == 1);
 }
@@ -0,0 +1,131 @@
+#include "../include/bam/cancellation.hpp"
+#include "../include/bam/parallel_copy.hpp"
+#include "../include/bam/parallel_find.hpp"
+#include "../include/bam/parallel_for.hpp"
+#include "../include/bam/parallel_for_each.hpp"
+#include "../include/bam/parallel_invoke.hpp"
+#include "../include/bam/parallel_reduce.hpp"
+#include "../include/bam/parallel_transform.hpp"
+#include "../include/bam/task_pool.hpp"
+#include "catch.hpp"
+
+#include <atomic>
+#include <vector>
+
+TEST_CASE("cancellation/1", "tokens see the cancellation of their source") {
+    bam::cancellation_token never;
+    CHECK(!never.is_cancelled());
+    CHECK_NOTHROW(never.throw_if_cancelled());
+
+    bam::cancellation_token token;
+    {
+        bam::cancellation_source source;
+        token = source.token();
+        auto copy = token;
+        CHECK(!copy.is_cancelled());
+        source.cancel();
+        CHECK(source.is_cancelled());
+        CHECK(copy.is_cancelled());
+    }
+    CHECK(token.is_cancelled()); // outlives its source
+    CHECK_THROWS_AS(token.throw_if_cancelled(), bam::operation_cancelled);
+}
+
+TEST_CASE("cancellation/2", "parallel_ calls with a cancelled token skip their bodies and throw") {
+    bam::cancellation_source source;
+    source.cancel();
+    auto part = bam::auto_partitioner().cancel_with(source.token());
+
+    std::vector<int> v(10000, 1);
+    std::vector<int> out(v.size(), 0);
+    typedef std::vector<int>::iterator iter;
+    std::atomic<int> calls(0);
+
+    CHECK_THROWS_AS(bam::parallel_for(v, [&] (iter, iter) { ++calls; }, part), bam::operation_cancelled);
+    CHECK_THROWS_AS(bam::parallel_for_each(v, [&] (int) { ++calls; }, part), bam::operation_cancelled);
+    CHECK_THROWS_AS(bam::parallel_reduce(v, [&] (iter, iter) { ++calls; return 0; }, [] (int a, int b) { return a + b; }, part),
+                    bam::operation_cancelled);
+    CHECK_THROWS_AS(bam::parallel_find(v, 2, part), bam::operation_cancelled);
+    CHECK_THROWS_AS(bam::parallel_transform(v, out.begin(), [&] (int i) { ++calls; return i; }, part), bam::operation_cancelled);
+    CHECK_THROWS_AS(bam::parallel_copy(v, out.begin(), part), bam::operation_cancelled);
+    CHECK_THROWS_AS(bam::parallel_invoke(source.token(), [&] { ++calls; }, [&] { ++calls; }), bam::operation_cancelled);
+    CHECK(calls == 0);
+    CHECK(std::count(out.begin(), out.end(), 0) == static_cast<int>(out.size()));
+}
+
+TEST_CASE("cancellation/3", "chunks which haven't started are skipped once the token is cancelled") {
+    bam::cancellation_source source;
+    std::vector<int> v(10000, 0);
+    typedef std::vector<int>::iterator iter;
+    std::atomic<int> calls(0);
+
+    auto worker = [&] (iter b, iter e) {
+        ++calls;
+        source.cancel();
+        for(auto it = b; it != e; ++it) {
+            ++*it;
+        }
+    };
+    CHECK_THROWS_AS(bam::parallel_for(v, worker, bam::simple_partitioner(1).cancel_with(source.token())), bam::operation_cancelled);
+
+    // every thread finishes at most the chunk it had started
+    CHECK(calls >= 1);
+    CHECK(calls < static_cast<int>(v.size()) / 2);
+}
+
+TEST_CASE("cancellation/4", "bodies can poll the token") {
+    bam::cancellation_source source;
+    auto token = source.token();
+    std::vector<int> v(10000, 0);
+    typedef std::vector<int>::iterator iter;
+
+    std::atomic<int> visited(0);
+    auto worker = [&] (iter b, iter e) {
+        for(auto it = b; it != e && !token.is_cancelled(); ++it) {
+            if(++visited == 100) {
+                source.cancel();
+            }
+        }
+    };
+    CHECK_THROWS_AS(bam::parallel_for(v, worker, bam::auto_partitioner().cancel_with(token)), bam::operation_cancelled);
+    CHECK(visited < static_cast<int>(v.size()));
+
+    // untouched tokens change nothing
+    bam::cancellation_source other;
+    CHECK(bam::parallel_reduce(v, [] (iter b, iter e) { return static_cast<int>(e - b); }, [] (int a, int c) { return a + c; },
+                               bam::simple_partitioner().cancel_with(other.token())) == static_cast<int>(v.size()));
+}
+
+TEST_CASE("cancellation/5", "queued task_pool tasks are skipped once their token is cancelled") {
+    bam::task_pool pool;
+    bam::cancellation_source cancelled;
+    cancelled.cancel();
+    bam::cancellation_source running;
+    auto token = running.token(); // lvalues and temporaries are both accepted
+
+    std::atomic<int> count(0);
+    auto skipped = pool.add(cancelled.token(), [&] { ++count; });
+    auto ran = pool.add(token, [&] (int i) { count += i; return i; }, 2);
+
+    CHECK_THROWS_AS(skipped.get(), bam::operation_cancelled);
+    CHECK(ran.get() == 2);
+    CHECK(count == 2);
+
+    // tasks cancelled while queued either ran or report the cancellation
+    std::vector<bam::future<int>> futures;
+    for(int i = 0; i != 100; ++i) {
+        futures.push_back(pool.add(token, [&running] { running.cancel(); return 1; }));
+    }
+    int finished = 0;
+    int skipped_count = 0;
+    for(auto& f : futures) {
+        try {
+            finished += f.get();
+        } catch(const bam::operation_cancelled&) {
+            ++skipped_count;
+        }
+    }
+    CHECK(finished >= 1); // the first one to run cancels the rest
+    CHECK(finished + skipped_count == 100);
+    pool.wait_and_finish();
+}
@@ -0,0 +1,172 @@
+#include "../include/bam/concurrency.hpp"
+#include "../include/bam/detail/cpu_capacity.hpp"
+#include "../include/bam/parallel_for.hpp"
+#include "../include/bam/task_pool.hpp"
+#include "catch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("concurrency/1", "cgroup cpu quotas are rounded up to whole cpus") {
+    CHECK(bam::detail::parse_cpu_max("400000 100000\n") == 4);
+    CHECK(bam::detail::parse_cpu_max("150000 100000\n") == 2);
+    CHECK(bam::detail::parse_cpu_max("5000 100000\n") == 1);
+    CHECK(bam::detail::parse_cpu_max("max 100000\n") == 0);
+    CHECK(bam::detail::parse_cpu_max("") == 0);
+    CHECK(bam::detail::cpus_of_quota(-1, 100000) == 0);
+    CHECK(bam::detail::cpus_of_quota(200000, 100000) == 2);
+}
+
+TEST_CASE("concurrency/2", "the cgroup of the process is found for v1 and v2") {
+    std::string v2 = "0::/kubepods/pod1/abc\n";
+    std::string v1 = "12:memory:/kubepods/pod1\n4:cpu,cpuacct:/kubepods/pod1/abc\n1:name=systemd:/init.scope\n";
+    CHECK(bam::detail::parse_cgroup_path(v2, "") == "/kubepods/pod1/abc");
+    CHECK(bam::detail::parse_cgroup_path(v2, "cpu") == "");
+    CHECK(bam::detail::parse_cgroup_path(v1, "cpu") == "/kubepods/pod1/abc");
+    CHECK(bam::detail::parse_cgroup_path(v1, "cpuset") == "");
+    CHECK(bam::detail::parse_cgroup_path(v1, "") == "");
+}
+
+TEST_CASE("concurrency/3", "only positive numbers are taken from BAM_MAX_CONCURRENCY") {
+    CHECK(bam::detail::parse_concurrency("4") == 4);
+    CHECK(bam::detail::parse_concurrency(nullptr) == 0);
+    CHECK(bam::detail::parse_concurrency("") == 0);
+    CHECK(bam::detail::parse_concurrency("0") == 0);
+    CHECK(bam::detail::parse_concurrency("-2") == 0);
+    CHECK(bam::detail::parse_concurrency("4 cpus") == 0);
+}
+
+TEST_CASE("concurrency/4", "the detected concurrency never exceeds the hardware") {
+    auto cpus = bam::detail::available_cpus();
+    CHECK(cpus >= 1);
+    if(std::thread::hardware_concurrency()) {
+        CHECK(cpus <= static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    CHECK(bam::max_concurrency() >= 1);
+}
+
+TEST_CASE("concurrency/5", "set_max_concurrency limits parallel_ calls and task_pools") {
+    auto initial = bam::max_concurrency();
+    bam::set_max_concurrency(1);
+    CHECK(bam::max_concurrency() == 1);
+
+    std::mutex m;
+    std::set<std::thread::id> ids;
+    std::vector<int> v(10000, 0);
+    typedef std::vector<int>::iterator iter;
+    bam::parallel_for(v.begin(), v.end(), [&] (iter b, iter e) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            ids.insert(std::this_thread::get_id());
+        }
+        for(auto it = b; it != e; ++it) {
+            std::this_thread::yield();
+            *it += 1;
+        }
+    }, 1);
+    CHECK(std::count(v.begin(), v.end(), 1) == static_cast<int>(v.size()));
+    CHECK((ids == std::set<std::thread::id>{ std::this_thread::get_id() }));
+
+    ids.clear();
+    {
+        bam::task_pool pool;
+        for(int i = 0; i != 100; ++i) {
+            pool.add([&] {
+                std::lock_guard<std::mutex> lock(m);
+                ids.insert(std::this_thread::get_id());
+            });
+        }
+        pool.wait_and_finish();
+    }
+    CHECK(ids.size() == 1u);
+
+    bam::set_max_concurrency(0);
+    CHECK(bam::max_concurrency() == initial);
+}
+
+namespace {
+    bam::detail::cpu_info make_cpu(int cpu, int core, int l3, int package, int node) {
+        bam::detail::cpu_info info = { cpu, core, l3, package, node };
+        return info;
+    }
+}
+
+TEST_CASE("concurrency/6", "sysfs cpu lists are expanded") {
+    CHECK((bam::detail::parse_cpu_list("0-3,8,10-11\n") == std::vector<int>{ 0, 1, 2, 3, 8, 10, 11 }));
+    CHECK((bam::detail::parse_cpu_list("5") == std::vector<int>{ 5 }));
+    CHECK(bam::detail::parse_cpu_list("").empty());
+}
+
+TEST_CASE("concurrency/7", "workers go to every physical core before smt siblings") {
+    // 2 sockets with 2 cores each, cpu n + 4 is the smt sibling of cpu n
+    std::vector<bam::detail::cpu_info> cpus;
+    for(int cpu = 0; cpu != 8; ++cpu) {
+        auto package = cpu % 4 / 2;
+        cpus.push_back(make_cpu(cpu, cpu % 2, package * 2, package, package));
+    }
+
+    std::vector<int> order;
+    for(auto& info : bam::detail::placement_order(cpus)) {
+        order.push_back(info.cpu);
+    }
+    CHECK((order == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7 }));
+
+    // thief on cpu 0 steals from its sibling, then its socket, then the other socket
+    auto levels = bam::detail::steal_levels(bam::detail::placement_order(cpus), 0);
+    REQUIRE(levels.size() == 3u);
+    CHECK((levels[0] == std::vector<std::size_t>{ 4 }));
+    CHECK((levels[1] == std::vector<std::size_t>{ 1, 5 }));
+    CHECK((levels[2] == std::vector<std::size_t>{ 2, 3, 6, 7 }));
+}
+
+TEST_CASE("concurrency/8", "the topology covers every allowed cpu once") {
+    auto& topology = bam::detail::get_topology();
+    REQUIRE(!topology.empty());
+    std::set<int> cpus;
+    for(auto& info : topology) {
+        cpus.insert(info.cpu);
+    }
+    CHECK(cpus.size() == topology.size());
+}
+
+TEST_CASE("concurrency/9", "pinned task_pool workers run all tasks") {
+    auto initial = bam::worker_pinning();
+    bam::set_worker_pinning(true);
+    std::atomic<int> count(0);
+    std::atomic<bool> pinned(true);
+    auto caller = std::this_thread::get_id(); // helps in wait without being pinned
+    {
+        bam::task_pool pool;
+        for(int i = 0; i != 1000; ++i) {
+            pool.add([&] {
+                ++count;
+                if(std::this_thread::get_id() != caller && bam::detail::allowed_cpus().size() > 1) {
+                    pinned = false;
+                }
+            });
+        }
+        pool.wait();
+        CHECK(count == 1000);
+        pool.wait_and_finish();
+    }
+    bam::set_worker_pinning(initial);
+    CHECK(pinned);
+}
+
+TEST_CASE("concurrency/10", "cpu capacities are relative to the fastest cpu") {
+    auto arm = bam::detail::parse_capacities({ "1024\n", "1024\n", "512\n", "" }, {}, 0.5);
+    CHECK((arm == std::vector<double>{ 1.0, 1.0, 0.5, 1.0 }));
+
+    // hybrid intel, cpu 2 and 3 are efficiency cores
+    auto hybrid = bam::detail::parse_capacities({ "", "", "", "" }, { 2, 3 }, 0.6);
+    CHECK((hybrid == std::vector<double>{ 1.0, 1.0, 0.6, 0.6 }));
+
+    CHECK(bam::detail::mean_if_unequal({ 1.0, 0.98 }) == 0);
+    CHECK(bam::detail::mean_if_unequal({ 1.0, 0.5 }) == Approx(0.75));
+    CHECK(bam::detail::thread_capacity() > 0);
+}
@@ -0,0 +1,120 @@
+#include "../include/bam/future.hpp"
+#include "../include/bam/task_pool.hpp"
+#include "catch.hpp"
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("future/1", "promise sets value") {
+  bam::promise<int> p;
+  auto f = p.get_future();
+  CHECK(f.valid());
+  CHECK(!f.ready());
+  p.set_value(42);
+  CHECK(f.ready());
+  CHECK(f.get() == 42);
+  CHECK(!f.valid());
+}
+
+TEST_CASE("future/2", "promise sets exception") {
+  bam::promise<std::string> p;
+  auto f = p.get_future();
+  p.set_exception(std::make_exception_ptr(std::runtime_error("future excep")));
+  CHECK_THROWS_AS(f.get(), std::runtime_error);
+}
+
+TEST_CASE("future/3", "destroying an unfulfilled promise breaks it") {
+  bam::future<void> f;
+  {
+    bam::promise<void> p;
+    f = p.get_future();
+  }
+  CHECK_THROWS_AS(f.get(), std::future_error);
+}
+
+TEST_CASE("future/4", "value set from another thread wakes a blocked get") {
+  bam::promise<int> p;
+  auto f = p.get_future();
+  std::thread t([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    p.set_value(1);
+  });
+  CHECK(f.get() == 1);
+  t.join();
+}
+
+TEST_CASE("future/5", "wait_for times out and reports deferred functions") {
+  bam::promise<int> p;
+  auto f = p.get_future();
+  CHECK(f.wait_for(std::chrono::milliseconds(1)) == std::future_status::timeout);
+  p.set_value(1);
+  CHECK(f.wait_for(std::chrono::milliseconds(1)) == std::future_status::ready);
+
+  auto deferred = bam::detail::make_deferred_future([] (int x) { return x * 2; }, 21);
+  CHECK(deferred.wait_for(std::chrono::milliseconds(1)) == std::future_status::deferred);
+  CHECK(deferred.get() == 42);
+}
+
+TEST_CASE("future/6", "states are recycled across threads") {
+  bam::task_pool pool;
+  for(int round = 0; round != 10; ++round) {
+    std::vector<bam::future<int>> futures;
+    for(int i = 0; i != 1000; ++i) {
+      futures.push_back(pool.add([i] { return i; }));
+    }
+    int sum = 0;
+    for(auto& f : futures) {
+      sum += f.get();
+    }
+    CHECK(sum == 999 * 1000 / 2);
+  }
+}
+
+namespace {
+  int parallel_fib(bam::task_pool& pool, int n) {
+    if(n < 2) {
+      return n;
+    }
+    auto left = pool.add(parallel_fib, std::ref(pool), n - 1);
+    auto right = pool.add(parallel_fib, std::ref(pool), n - 2);
+    return left.get() + right.get();
+  }
+}
+
+TEST_CASE("future/7", "tasks waiting on their subtasks run other tasks instead of blocking the worker") {
+  bam::task_pool pool;
+  auto f = pool.add(parallel_fib, std::ref(pool), 18);
+  CHECK(f.get() == 2584);
+  pool.wait_and_finish();
+}
+
+TEST_CASE("future/8", "misusing a promise throws like std::promise") {
+  auto code_of = [] (const std::function<void()>& misuse) {
+    try {
+      misuse();
+    }
+    catch(const std::future_error& e) {
+      return e.code();
+    }
+    return std::error_code();
+  };
+
+  bam::promise<int> p;
+  p.set_value(1);
+  CHECK(p.get_future().get() == 1);
+  CHECK(code_of([&] { p.set_value(2); }) == std::future_errc::promise_already_satisfied);
+  CHECK(code_of([&] { p.set_exception(std::make_exception_ptr(std::runtime_error("late"))); }) == std::future_errc::promise_already_satisfied);
+  CHECK(code_of([&] { p.get_future(); }) == std::future_errc::future_already_retrieved);
+
+  bam::promise<void> moved_from;
+  auto f = moved_from.get_future();
+  bam::promise<void> target(std::move(moved_from));
+  CHECK(code_of([&] { moved_from.set_value(); }) == std::future_errc::no_state);
+  CHECK(code_of([&] { moved_from.set_exception(std::make_exception_ptr(std::runtime_error("gone"))); }) == std::future_errc::no_state);
+  CHECK(code_of([&] { moved_from.get_future(); }) == std::future_errc::no_state);
+  target.set_value();
+  f.get();
+}
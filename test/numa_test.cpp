@@ -0,0 +1,39 @@
+#include "../include/bam/concurrency.hpp"
+#include "../include/bam/numa.hpp"
+#include "catch.hpp"
+
+#include <algorithm>
+#include <vector>
+
+TEST_CASE("numa/1", "first touched vectors hold the value everywhere") {
+    bam::affinity_partitioner part;
+    bam::first_touch_vector<double> v(100000);
+    bam::parallel_first_touch(v, 1.5, part);
+    CHECK(std::count(v.begin(), v.end(), 1.5) == static_cast<int>(v.size()));
+
+    // later loops reuse the partitioner
+    typedef bam::first_touch_vector<double>::iterator iter;
+    bam::parallel_for(v, [] (iter b, iter e) { for(auto it = b; it != e; ++it) { *it *= 2; } }, part);
+    CHECK(std::count(v.begin(), v.end(), 3.0) == static_cast<int>(v.size()));
+
+    bam::parallel_first_touch(v.begin(), v.begin() + 10, 0.0, bam::auto_partitioner());
+    CHECK(std::count(v.begin(), v.end(), 0.0) == 10);
+}
+
+TEST_CASE("numa/2", "first_touch_allocator still constructs with arguments") {
+    bam::first_touch_vector<std::vector<int>> v;
+    v.emplace_back(3, 7);
+    v.push_back(std::vector<int>{ 1, 2 });
+    v.resize(3);
+    CHECK((v[0] == std::vector<int>{ 7, 7, 7 }));
+    CHECK((v[1] == std::vector<int>{ 1, 2 }));
+    CHECK(v[2].empty());
+}
+
+TEST_CASE("numa/3", "every cpu is on a known node") {
+    REQUIRE(bam::numa_node_count() >= 1);
+    for(auto& cpu : bam::detail::get_topology()) {
+        CHECK(cpu.node >= 0);
+        CHECK(cpu.node == bam::detail::node_of_cpu(cpu.cpu));
+    }
+}
@@ -0,0 +1,49 @@
+#include "../include/bam/parallel_adjacent_find.hpp"
+#include "catch.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <vector>
+
+TEST_CASE("parallel_adjacent_find/1", "the first pair is found like std::adjacent_find does") {
+    std::vector<int> v(100000);
+    std::iota(v.begin(), v.end(), 0);
+    CHECK(bam::parallel_adjacent_find(v) == v.end());
+
+    v[60001] = v[60000];
+    v[31235] = v[31234];
+    CHECK(bam::parallel_adjacent_find(v) == v.begin() + 31234);
+    CHECK(bam::parallel_adjacent_find(v.begin(), v.end()) == std::adjacent_find(v.begin(), v.end()));
+    CHECK(bam::parallel_adjacent_find(v, std::equal_to<int>(), bam::simple_partitioner(1).cost_hint(std::chrono::milliseconds(1))) == v.begin() + 31234);
+    CHECK(bam::parallel_adjacent_find(v.begin(), v.end(), [] (int a, int b) { return b - a > 1; }, bam::auto_partitioner()) == v.begin() + 31235);
+
+    // pairs across chunk borders
+    std::vector<int> w(1000, 0);
+    std::iota(w.begin(), w.end(), 0);
+    w[100] = w[99];
+    CHECK(bam::parallel_adjacent_find(w, std::equal_to<int>(), 100) == w.begin() + 99);
+    w[100] = 100;
+    w[999] = w[998];
+    CHECK(bam::parallel_adjacent_find(w, std::equal_to<int>(), 100) == w.begin() + 998);
+
+    std::vector<int> single(1, 0);
+    CHECK(bam::parallel_adjacent_find(single) == single.end());
+}
+
+TEST_CASE("parallel_adjacent_find/2", "is_sorted and is_partitioned agree with the std versions") {
+    std::vector<int> v(100000);
+    std::iota(v.begin(), v.end(), 0);
+    CHECK(bam::parallel_is_sorted(v));
+    CHECK(bam::parallel_is_sorted(v.rbegin(), v.rend(), std::greater<int>()));
+    CHECK(!bam::parallel_is_sorted(v, std::greater<int>(), bam::auto_partitioner()));
+
+    auto small = [] (int i) { return i < 500; };
+    CHECK(bam::parallel_is_partitioned(v, small));
+    CHECK(bam::parallel_is_partitioned(v.begin(), v.end(), [] (int) { return false; }, bam::simple_partitioner(64)));
+
+    std::swap(v[400], v[90000]);
+    CHECK(!bam::parallel_is_sorted(v.begin(), v.end()));
+    CHECK(!bam::parallel_is_partitioned(v, small, 10));
+    CHECK(bam::parallel_is_partitioned(v, small) == std::is_partitioned(v.begin(), v.end(), small));
+}
@@ -0,0 +1,39 @@
+#include "../include/bam/parallel_any_of.hpp"
+#include "catch.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+TEST_CASE("parallel_any_of/1", "any_of, all_of and none_of agree with the std versions") {
+    std::vector<int> v(100000, 2);
+    auto even = [] (int i) { return i % 2 == 0; };
+    auto odd = [] (int i) { return i % 2 == 1; };
+
+    CHECK(bam::parallel_any_of(v, even));
+    CHECK(!bam::parallel_any_of(v, odd));
+    CHECK(bam::parallel_all_of(v, even));
+    CHECK(bam::parallel_none_of(v.begin(), v.end(), odd));
+
+    v[77777] = 3;
+    CHECK(bam::parallel_any_of(v.begin(), v.end(), odd, bam::auto_partitioner()));
+    CHECK(!bam::parallel_all_of(v, even, bam::simple_partitioner(100)));
+    CHECK(!bam::parallel_none_of(v, odd, 10));
+
+    std::vector<int> empty;
+    CHECK(!bam::parallel_any_of(empty, even));
+    CHECK(bam::parallel_all_of(empty, odd));
+    CHECK(bam::parallel_none_of(empty, even));
+}
+
+TEST_CASE("parallel_any_of/2", "an early violation ends the scan") {
+    std::vector<int> v(1000000, 0);
+    v[10] = 1;
+    std::atomic<long> calls(0);
+    auto zero = [&] (int i) {
+        ++calls;
+        return i == 0;
+    };
+    CHECK(!bam::parallel_all_of(v, zero, bam::auto_partitioner().cost_hint(std::chrono::nanoseconds(10))));
+    CHECK(calls < static_cast<long>(v.size()) / 2);
+}
@@ -1,6 +1,11 @@
 #include "catch.hpp"
 #include "../include/bam/parallel_find.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <vector>
+
 TEST_CASE("parallel_find/1", "testing positive") {
     std::vector<int> v {1, 2, 3, 4, 5, 6};
     CHECK(bam::parallel_find(v, 3) == v.begin() + 2);
@@ -10,3 +15,55 @@ TEST_CASE("parallel_find/2", "testing negative") {
     std::vector<int> v {1, 2, 3, 4, 5, 6};
     CHECK(bam::parallel_find(v, 8) == v.end());
 }
+
+TEST_CASE("parallel_find/3", "partitioner overloads") {
+    std::vector<int> v(100000, 0);
+    v[77777] = 1;
+    CHECK(bam::parallel_find(v, 1, bam::auto_partitioner()) == v.begin() + 77777);
+    CHECK(bam::parallel_find(v.begin(), v.end(), 1, bam::auto_partitioner()) == v.begin() + 77777);
+    CHECK(bam::parallel_find(v, 2, bam::simple_partitioner(10)) == v.end());
+    CHECK(bam::parallel_find(v.begin(), v.end(), 2, bam::auto_partitioner()) == v.end());
+}
+
+TEST_CASE("parallel_find/4", "values in the part searched on the calling thread are found") {
+    std::vector<int> v(100000, 0);
+    v[0] = 1;
+    v[5] = 2;
+    CHECK(bam::parallel_find(v, 1) == v.begin());
+    CHECK(bam::parallel_find(v, 2) == v.begin() + 5);
+    CHECK(bam::parallel_find(v, 2, bam::auto_partitioner().cost_hint(std::chrono::nanoseconds(1))) == v.begin() + 5);
+    CHECK(bam::parallel_find(v.begin(), v.begin() + 5, 2) == v.begin() + 5);
+}
+
+TEST_CASE("parallel_find/5", "the first occurrence is found like std::find does") {
+    std::vector<int> v(100000, 0);
+    for(int i : { 99999, 60000, 31234, 31235, 5000 }) {
+        v[i] = 1;
+    }
+    CHECK(bam::parallel_find(v, 1) == v.begin() + 5000);
+    CHECK(bam::parallel_find(v, 1, bam::simple_partitioner(1).cost_hint(std::chrono::milliseconds(1))) == v.begin() + 5000);
+    CHECK(bam::parallel_find(v, 1, bam::auto_partitioner().cost_hint(std::chrono::milliseconds(1))) == v.begin() + 5000);
+
+    v[5000] = 0;
+    CHECK(bam::parallel_find(v.begin(), v.end(), 1, bam::affinity_partitioner()) == v.begin() + 31234);
+}
+
+TEST_CASE("parallel_find/6", "parallel_find_if returns the first match and skips the chunks behind it") {
+    std::vector<int> v(1000000);
+    std::iota(v.begin(), v.end(), 0);
+    std::atomic<long> calls(0);
+    auto pred = [&] (int i) {
+        ++calls;
+        return i % 1000 == 999;
+    };
+
+    CHECK(bam::parallel_find_if(v, pred) == v.begin() + 999);
+    CHECK(calls < static_cast<long>(v.size()) / 2);
+
+    calls = 0;
+    auto late = bam::parallel_find_if(v.begin(), v.end(), [] (int i) { return i >= 777777; }, bam::auto_partitioner());
+    CHECK(late == v.begin() + 777777);
+    CHECK(bam::parallel_find_if(v, [] (int i) { return i < 0; }, bam::simple_partitioner(100)) == v.end());
+    CHECK(bam::parallel_find_if(v.begin(), v.begin(), pred) == v.begin());
+    CHECK(calls == 0);
+}
@@ -1,6 +1,7 @@
 #include "../include/bam/parallel_for_each.hpp"
 #include "catch.hpp"
 
+#include <algorithm>
 #include <numeric>
 #include <vector>
 #include <exception>
@@ -50,3 +51,13 @@ TEST_CASE("parallel_for_each/6", "testing range overloads") {
 }
 
 
+
+TEST_CASE("parallel_for_each/7", "repeated calls with an affinity_partitioner") {
+    std::vector<int> v(100000, 0);
+    bam::affinity_partitioner part;
+    for(int i = 0; i != 20; ++i) {
+        bam::parallel_for_each(v, [] (int& x) { ++x; }, part);
+    }
+    bam::parallel_for_each(v.begin(), v.end(), [] (int& x) { ++x; }, part);
+    CHECK(std::count(v.begin(), v.end(), 21) == static_cast<int>(v.size()));
+}
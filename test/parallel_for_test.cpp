@@ -1,11 +1,63 @@
+#include "../include/bam/concurrency.hpp"
 #include "../include/bam/parallel_for.hpp"
 #include "catch.hpp"
 
 #include <boost/range/irange.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <mutex>
 #include <numeric>
+#include <set>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
+namespace {
+    std::atomic<long> allocations(0);
+}
+
+// counts all allocations of the test binary, such that tests can check for allocation free paths
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations;
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new(std::size_t size) {
+    if(auto p = operator new(size, std::nothrow)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
 TEST_CASE("parallel_for/1", "parallel_for on small range ") {
   std::vector<int> v(6, 1);
   typedef std::vector<int>::iterator iter;
@@ -87,3 +139,375 @@ TEST_CASE("parallel_for/7", "testing parallel_for range overloads") {
     CHECK(std::accumulate(v.begin(), v.end(), 0) == 4 * static_cast<int>(v.size()));
 }
 
+TEST_CASE("parallel_for/8", "many consecutive calls reuse the worker pool") {
+    std::vector<int> v(1000, 0);
+    typedef std::vector<int>::iterator iter;
+    auto worker = [] (iter b, iter e) { for(auto it = b; it != e; ++it) { *it += 1; } };
+
+    for(int i = 0; i != 1000; ++i) {
+        bam::parallel_for(v.begin(), v.end(), worker);
+    }
+    CHECK(std::accumulate(v.begin(), v.end(), 0) == 1000 * static_cast<int>(v.size()));
+}
+
+TEST_CASE("parallel_for/9", "every element is visited exactly once with fine grain and skewed work") {
+    std::vector<int> v(100000, 0);
+    typedef std::vector<int>::iterator iter;
+    auto worker = [&] (iter b, iter e) {
+        for(auto it = b; it != e; ++it) {
+            if(it - v.begin() < 1000) {
+                std::this_thread::yield(); // make the front expensive such that the back gets stolen
+            }
+            *it += 1;
+        }
+    };
+
+    bam::parallel_for(v.begin(), v.end(), worker, 1);
+    CHECK(std::count(v.begin(), v.end(), 1) == static_cast<int>(v.size()));
+}
+
+TEST_CASE("parallel_for/10", "nested calls run on the existing workers") {
+    std::atomic<int> visits(0);
+    std::mutex m;
+    std::set<std::thread::id> ids;
+
+    auto inner = [&] (int b, int e) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            ids.insert(std::this_thread::get_id());
+        }
+        visits += e - b;
+    };
+    auto middle = [&] (int b, int e) {
+        for(int i = b; i != e; ++i) {
+            bam::parallel_for(0, 100, inner, 1);
+        }
+    };
+    bam::parallel_for(0, 20, [&] (int b, int e) {
+        for(int i = b; i != e; ++i) {
+            bam::parallel_for(0, 10, middle, 1);
+        }
+    }, 1);
+
+    CHECK(visits == 20 * 10 * 100);
+    CHECK(ids.size() <= static_cast<std::size_t>(bam::detail::get_worker_pool().size()) + 1);
+}
+
+TEST_CASE("parallel_for/11", "auto_partitioner visits every element exactly once with skewed work") {
+    std::vector<int> v(100000, 0);
+    std::atomic<int> calls(0);
+    typedef std::vector<int>::iterator iter;
+    auto worker = [&] (iter b, iter e) {
+        ++calls;
+        for(auto it = b; it != e; ++it) {
+            if(it - v.begin() < 1000) {
+                std::this_thread::yield();
+            }
+            *it += 1;
+        }
+    };
+
+    bam::parallel_for(v.begin(), v.end(), worker, bam::auto_partitioner());
+    CHECK(std::count(v.begin(), v.end(), 1) == static_cast<int>(v.size()));
+
+    // claims grow, so there are fewer calls than chunks of the simple partitioner
+    auto auto_calls = calls.exchange(0);
+    bam::parallel_for(v, worker, bam::simple_partitioner(100));
+    CHECK(std::count(v.begin(), v.end(), 2) == static_cast<int>(v.size()));
+    CHECK(calls == 1000);
+    CHECK(auto_calls < 1000);
+}
+
+TEST_CASE("parallel_for/12", "pieces a slot ran last time are handed to it first") {
+    std::vector<int> pieces { 0, 1, 2, 3, 4, 5 };
+    std::vector<int> order;
+    auto foo = [&] (int& piece) { order.push_back(piece); };
+    bam::detail::task_results<void> results(pieces.size());
+    bam::detail::affinity_record previous;
+    previous.slots = { 3, 0, 2, 0, 1, 0 }; // this thread is slot 0
+
+    bam::detail::affine_element_job<std::vector<int>, decltype(foo), decltype(results)> job(pieces, foo, results, previous);
+    job.participate();
+
+    CHECK((order == std::vector<int>{ 1, 3, 5, 0, 2, 4 }));
+    CHECK(std::count(job.slots().begin(), job.slots().end(), 0) == static_cast<int>(pieces.size()));
+}
+
+TEST_CASE("parallel_for/13", "calls on small ranges don't allocate") {
+    std::vector<int> v(16, 0);
+    typedef std::vector<int>::iterator iter;
+    auto worker = [] (iter b, iter e) { for(auto it = b; it != e; ++it) { *it += 1; } };
+    // a big cost hint keeps the range from running inline below the cutoff, such that the pool is used
+    auto costly = std::chrono::milliseconds(1);
+    bam::parallel_for(v.begin(), v.end(), worker, bam::simple_partitioner().cost_hint(costly)); // starts the worker pool
+
+    auto before = allocations.load();
+    for(int i = 0; i != 100; ++i) {
+        bam::parallel_for(v.begin(), v.end(), worker, bam::simple_partitioner().cost_hint(costly));
+        bam::parallel_for(v.begin(), v.end(), worker, bam::auto_partitioner().cost_hint(costly));
+    }
+    CHECK(allocations.load() == before);
+    CHECK(std::count(v.begin(), v.end(), 201) == static_cast<int>(v.size()));
+}
+
+TEST_CASE("parallel_for/14", "cheap small ranges run on the calling thread") {
+    std::vector<int> v(5, 0);
+    std::mutex m;
+    std::set<std::thread::id> ids;
+    typedef std::vector<int>::iterator iter;
+    auto worker = [&] (iter b, iter e) {
+        std::lock_guard<std::mutex> lock(m);
+        ids.insert(std::this_thread::get_id());
+        for(auto it = b; it != e; ++it) { *it += 1; }
+    };
+
+    bam::parallel_for(v, worker, bam::auto_partitioner().cost_hint(std::chrono::nanoseconds(1)));
+    bam::parallel_for(v.begin(), v.end(), worker, bam::simple_partitioner(1).cost_hint(std::chrono::nanoseconds(1)));
+    CHECK(std::count(v.begin(), v.end(), 2) == static_cast<int>(v.size()));
+    CHECK((ids == std::set<std::thread::id>{ std::this_thread::get_id() }));
+}
+
+TEST_CASE("parallel_for/15", "ranges timed on the calling thread first are still visited once") {
+    std::vector<std::atomic<int>> v(5000);
+    for(auto& i : v) {
+        i = 0;
+    }
+    typedef std::vector<std::atomic<int>>::iterator iter;
+    auto worker = [] (iter b, iter e) {
+        for(auto it = b; it != e; ++it) {
+            std::this_thread::yield();
+            ++*it;
+        }
+    };
+
+    bam::parallel_for(v.begin(), v.end(), worker);
+    bam::parallel_for(v.begin(), v.end(), worker, bam::simple_partitioner(3).cost_hint(std::chrono::milliseconds(1)));
+    CHECK(std::all_of(v.begin(), v.end(), [] (const std::atomic<int>& i) { return i == 2; }));
+}
+
+TEST_CASE("parallel_for/16", "weighted slices follow the capacity and cover every chunk") {
+    bam::detail::weighted_slicer slicer;
+    slicer.reset(100, 4, 1.0);
+    auto fast = slicer.claim(2.0);
+    auto slow = slicer.claim(0.5);
+    auto medium = slicer.claim(1.0);
+    auto last = slicer.claim(0.5);
+
+    CHECK((fast == std::make_pair(0u, 50u)));
+    CHECK((slow == std::make_pair(50u, 59u)));
+    CHECK((medium == std::make_pair(59u, 80u)));
+    CHECK((last == std::make_pair(80u, 100u)));
+}
+
+TEST_CASE("parallel_for/17", "every element is visited once with simulated slow cores") {
+    auto& capacities = bam::detail::slot_capacities();
+    for(int slot = 0; slot <= bam::detail::get_worker_pool().size(); ++slot) {
+        capacities.push_back(slot % 2 ? 0.4 : 1.0);
+    }
+    if(capacities.size() == 1) { // no workers, pretend the calling thread is slow
+        capacities.push_back(1.0);
+        capacities[0] = 0.4;
+    }
+
+    std::vector<std::atomic<int>> v(20000);
+    for(auto& i : v) {
+        i = 0;
+    }
+    typedef std::vector<std::atomic<int>>::iterator iter;
+    auto worker = [] (iter b, iter e) {
+        for(auto it = b; it != e; ++it) {
+            ++*it;
+        }
+    };
+    bam::parallel_for(v.begin(), v.end(), worker, bam::simple_partitioner(7).cost_hint(std::chrono::milliseconds(1)));
+    bam::parallel_for(v.begin(), v.end(), worker, bam::auto_partitioner().cost_hint(std::chrono::milliseconds(1)));
+
+    // straight through the scheduler, which the calls above skip if there are no workers
+    bam::detail::work_ranges<iter> work;
+    bam::detail::make_work(work, v.begin(), v.end(), 2000, 7);
+    auto helper = [&] (bam::detail::work_range<iter>& range) {
+        std::pair<iter, iter> chunk;
+        while(range.try_fetch_work(chunk, work)) {
+            worker(chunk.first, chunk.second);
+        }
+    };
+    bam::detail::task_results<void> results(work.size());
+    bam::detail::spawn_tasks(work, helper, results);
+    bam::detail::get_tasks(results);
+    capacities.clear();
+
+    CHECK(std::all_of(v.begin(), v.end(), [] (const std::atomic<int>& i) { return i == 3; }));
+}
+
+TEST_CASE("parallel_for/18", "default grainsizes fit the caches and cover whole cache lines") {
+    CHECK(bam::detail::parse_cache_size("48K\n") == 48u * 1024);
+    CHECK(bam::detail::parse_cache_size("2M") == 2u * 1024 * 1024);
+    CHECK(bam::detail::parse_cache_size("") == 0u);
+    CHECK(bam::detail::get_cache_sizes().l1d > 0u);
+
+    struct triple { double a, b, c; };
+    struct page { char data[4096]; };
+    CHECK(bam::detail::elements_per_cache_line<double>() == 8u);
+    CHECK(bam::detail::elements_per_cache_line<triple>() == 8u);
+    CHECK(bam::detail::elements_per_cache_line<page>() == 1u);
+
+    bam::detail::cache_sizes caches = { 32 * 1024, 256 * 1024 };
+    CHECK(bam::detail::fit_to_caches<double>(625, 62500, caches) == 2048); // grows to half the L1
+    CHECK(bam::detail::fit_to_caches<double>(10, 1000, caches) == 248); // keeps chunks to steal, rounded to lines
+    CHECK(bam::detail::fit_to_caches<page>(625, 62500, caches) == 32); // shrinks to half the L2
+    CHECK(bam::detail::fit_to_caches<double>(3, 12, caches) == 3); // less than a line stays as it is
+}
+
+TEST_CASE("parallel_for/19", "aligned chunks start on cache lines and visit every element once") {
+    std::vector<double> v(10000, 0);
+    typedef std::vector<double>::iterator iter;
+    auto begin = v.begin() + 3; // most likely not on a cache line
+
+    std::mutex m;
+    std::vector<std::pair<iter, iter>> chunks;
+    bam::detail::work_ranges<iter> work;
+    bam::detail::make_work(work, begin, v.end(), 1000, 64, bam::detail::claim_policy::fixed, true);
+    auto helper = [&] (bam::detail::work_range<iter>& range) {
+        std::pair<iter, iter> chunk;
+        while(range.try_fetch_work(chunk, work)) {
+            for(auto it = chunk.first; it != chunk.second; ++it) {
+                *it += 1;
+            }
+            std::lock_guard<std::mutex> lock(m);
+            chunks.push_back(chunk);
+        }
+    };
+    bam::detail::task_results<void> results(work.size());
+    bam::detail::spawn_tasks(work, helper, results);
+    bam::detail::get_tasks(results);
+
+    CHECK(std::all_of(begin, v.end(), [] (double d) { return d == 1; }));
+    for(auto& chunk : chunks) {
+        CHECK(chunk.first < chunk.second);
+        if(chunk.first != begin) {
+            CHECK(reinterpret_cast<std::uintptr_t>(&*chunk.first) % bam::detail::cache_line_size == 0);
+        }
+        CHECK(chunk.second - chunk.first <= 64);
+    }
+}
+
+TEST_CASE("parallel_for/20", "the first exception stops the chunks which haven't started") {
+    std::vector<int> v(10000, 0);
+    typedef std::vector<int>::iterator iter;
+    std::atomic<int> calls(0);
+    auto worker = [&] (iter, iter) {
+        ++calls;
+        throw std::runtime_error("testing exception");
+    };
+    CHECK_THROWS_AS(bam::parallel_for(v, worker, 1), std::runtime_error);
+    CHECK_THROWS_AS(bam::parallel_for(v, worker, bam::auto_partitioner().cost_hint(std::chrono::milliseconds(1))), std::runtime_error);
+
+    // every thread fails at most the chunk it had started
+    CHECK(calls >= 2);
+    CHECK(calls < static_cast<int>(v.size()));
+}
+
+TEST_CASE("parallel_for/21", "collected exceptions are thrown together") {
+    std::vector<int> v(10000, 0);
+    typedef std::vector<int>::iterator iter;
+    std::atomic<int> calls(0);
+    auto worker = [&] (iter, iter) {
+        ++calls;
+        throw std::runtime_error("testing exception");
+    };
+
+    try {
+        bam::parallel_for(v, worker, bam::simple_partitioner(1).collect_exceptions());
+        FAIL("no exception");
+    }
+    catch(const bam::aggregate_exception& e) {
+        CHECK(static_cast<int>(e.exceptions().size()) == calls.load());
+        for(auto& error : e.exceptions()) {
+            CHECK_THROWS_AS(std::rethrow_exception(error), std::runtime_error);
+        }
+    }
+
+    // a nested collecting call doesn't nest aggregates
+    try {
+        bam::parallel_for(v.begin(), v.begin() + 2, [&] (iter, iter) {
+            bam::parallel_for(v, worker, bam::simple_partitioner(1).collect_exceptions());
+        }, bam::simple_partitioner(1).collect_exceptions());
+        FAIL("no exception");
+    }
+    catch(const bam::aggregate_exception& e) {
+        REQUIRE(!e.exceptions().empty());
+        CHECK_THROWS_AS(std::rethrow_exception(e.exceptions().front()), std::runtime_error);
+    }
+}
+
+TEST_CASE("parallel_for/22", "an explicit grainsize is kept by the part timed on the calling thread") {
+    std::vector<int> v(100000, 0);
+    typedef std::vector<int>::iterator iter;
+    std::atomic<int> off_grid(0);
+    std::atomic<int> short_chunks(0);
+    std::atomic<int> calls(0);
+    auto worker = [&] (iter b, iter e) {
+        ++calls;
+        if((b - v.begin()) % 64 != 0) {
+            ++off_grid;
+        }
+        if(e - b != 64 && e != v.end()) {
+            ++short_chunks;
+        }
+        for(auto it = b; it != e; ++it) {
+            *it += 1;
+        }
+    };
+
+    bam::parallel_for(v.begin(), v.end(), worker, 64);
+    bam::parallel_for(v, worker, bam::simple_partitioner(64));
+    CHECK(off_grid == 0);
+    CHECK(short_chunks == 0);
+    CHECK(calls == 2 * 1563);
+    CHECK(std::count(v.begin(), v.end(), 2) == static_cast<int>(v.size()));
+}
+
+TEST_CASE("parallel_for/23", "a coarse first element doesn't hold up the others") {
+    auto element_time = std::chrono::milliseconds(50);
+    std::vector<std::atomic<int>> v(8);
+    for(auto& i : v) {
+        i = 0;
+    }
+    typedef std::vector<std::atomic<int>>::iterator iter;
+    auto worker = [element_time] (iter b, iter e) {
+        for(auto it = b; it != e; ++it) {
+            std::this_thread::sleep_for(element_time);
+            ++*it;
+        }
+    };
+
+    // every thread can take one element at a time, without workers the elements run one after another
+    auto threads = bam::detail::get_worker_pool().active_size() + 1;
+    auto rounds = (static_cast<int>(v.size()) + threads - 1) / threads;
+    auto start = std::chrono::steady_clock::now();
+    bam::parallel_for(v.begin(), v.end(), worker);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    CHECK(elapsed < element_time * rounds + element_time * 9 / 10);
+    CHECK(std::all_of(v.begin(), v.end(), [] (const std::atomic<int>& i) { return i == 1; }));
+}
+
+TEST_CASE("parallel_for/24", "calls cutting two pieces for each of many threads don't allocate") {
+    std::vector<int> v(1024, 0);
+    typedef std::vector<int>::iterator iter;
+    auto worker = [] (iter b, iter e) { for(auto it = b; it != e; ++it) { *it += 1; } };
+    auto costly = std::chrono::milliseconds(1);
+    bam::parallel_for(v.begin(), v.end(), worker, bam::simple_partitioner().cost_hint(costly)); // starts the worker pool
+
+    // more pieces than threads only oversubscribes the workers there are
+    bam::set_max_concurrency(48);
+    auto before = allocations.load();
+    for(int i = 0; i != 10; ++i) {
+        bam::parallel_for(v.begin(), v.end(), worker, bam::simple_partitioner().cost_hint(costly));
+    }
+    auto after = allocations.load();
+    bam::set_max_concurrency(0);
+
+    CHECK(after == before);
+    CHECK(std::count(v.begin(), v.end(), 11) == static_cast<int>(v.size()));
+}
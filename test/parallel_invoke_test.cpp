@@ -2,6 +2,7 @@
 #include "catch.hpp"
 
 #include <numeric>
+#include <stdexcept>
 
 TEST_CASE("parallel_invoke/1", "testing 3 functions") {
   std::vector<int> v { 1, 2, 3 };
@@ -12,3 +13,15 @@ TEST_CASE("parallel_invoke/1", "testing 3 functions") {
   bam::parallel_invoke(foo1, foo2, foo3);
   CHECK(std::accumulate(std::begin(v), std::end(v), 0) == 12);
 }
+
+TEST_CASE("parallel_invoke/2", "an exception is rethrown, cancelled tokens skip the functions") {
+  auto thrower = [] () { throw std::runtime_error("testing exception"); };
+  auto nop = [] () {};
+  CHECK_THROWS_AS(bam::parallel_invoke(nop, thrower, nop), std::runtime_error);
+
+  int calls = 0;
+  bam::cancellation_source source;
+  source.cancel();
+  CHECK_THROWS_AS(bam::parallel_invoke(source.token(), [&] () { ++calls; }, [&] () { ++calls; }), bam::operation_cancelled);
+  CHECK(calls == 0);
+}
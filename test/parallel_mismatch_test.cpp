@@ -0,0 +1,43 @@
+#include "../include/bam/parallel_mismatch.hpp"
+#include "catch.hpp"
+
+#include <functional>
+#include <numeric>
+#include <vector>
+
+TEST_CASE("parallel_mismatch/1", "the first difference is found like std::mismatch does") {
+    std::vector<int> a(100000);
+    std::iota(a.begin(), a.end(), 0);
+    auto b = a;
+
+    auto none = bam::parallel_mismatch(a.begin(), a.end(), b.begin());
+    CHECK(none.first == a.end());
+    CHECK(none.second == b.end());
+
+    b[90000] = -1;
+    b[40000] = -1;
+    auto first = bam::parallel_mismatch(a, b);
+    CHECK(first.first == a.begin() + 40000);
+    CHECK(first.second == b.begin() + 40000);
+    CHECK(bam::parallel_mismatch(a.begin(), a.end(), b.begin(), std::equal_to<int>(), bam::auto_partitioner()).first == a.begin() + 40000);
+    CHECK(bam::parallel_mismatch(a.begin(), a.end(), b.begin(), [] (int x, int y) { return x >= y; }, 100).first == a.end());
+
+    // the range version stops at the end of the shorter range
+    std::vector<int> prefix(a.begin(), a.begin() + 100);
+    CHECK(bam::parallel_mismatch(prefix, a).first == prefix.end());
+}
+
+TEST_CASE("parallel_mismatch/2", "parallel_equal agrees with std::equal") {
+    std::vector<double> a(100000, 1.0);
+    auto b = a;
+    CHECK(bam::parallel_equal(a, b));
+    CHECK(bam::parallel_equal(a.begin(), a.end(), b.begin()));
+
+    b[99999] = 2.0;
+    CHECK(!bam::parallel_equal(a, b));
+    CHECK(!bam::parallel_equal(a.begin(), a.end(), b.begin(), std::equal_to<double>(), bam::simple_partitioner(1000)));
+    CHECK(bam::parallel_equal(a.begin(), a.end(), b.begin(), [] (double x, double y) { return x <= y; }, bam::auto_partitioner()));
+
+    std::vector<double> shorter(a.begin(), a.end() - 1);
+    CHECK(!bam::parallel_equal(shorter, a));
+}
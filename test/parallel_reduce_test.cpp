@@ -1,6 +1,10 @@
 #include "../include/bam/parallel_reduce.hpp"
 #include "catch.hpp"
 #include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
 
 TEST_CASE("parallel_reduce/1", "parallel_reduce on small range") {
   std::vector<int> v {1, 2, 3, 4, 5, 6};
@@ -66,3 +70,38 @@ TEST_CASE("parallel_reduce/7", "testing range overloads") {
     CHECK(bam::parallel_reduce(v.begin(), v.end(), worker, joiner, 1) == std::accumulate(v.begin(), v.end(), 0));
 }
 
+
+TEST_CASE("parallel_reduce/8", "partitioner overloads") {
+    std::vector<int> v(100000);
+    std::iota(v.begin(), v.end(), 0);
+    auto expected = std::accumulate(v.begin(), v.end(), 0LL);
+    auto worker = [] (std::vector<int>::iterator b, std::vector<int>::iterator e) { return std::accumulate(b, e, 0LL); };
+    auto joiner = std::plus<long long>();
+    CHECK(bam::parallel_reduce(v, worker, joiner, bam::auto_partitioner()) == expected);
+    CHECK(bam::parallel_reduce(v.begin(), v.end(), worker, joiner, bam::auto_partitioner()) == expected);
+    CHECK(bam::parallel_reduce(v, worker, joiner, bam::simple_partitioner(7)) == expected);
+    CHECK(bam::parallel_reduce(v.begin(), v.end(), worker, joiner, bam::simple_partitioner()) == expected);
+}
+
+TEST_CASE("parallel_reduce/9", "the part timed on the calling thread is joined in exactly once") {
+    std::vector<char> v(3000);
+    for(auto i = 0u; i != v.size(); ++i) {
+        v[i] = 'a' + i % 26;
+    }
+    typedef std::vector<char>::iterator iter;
+    auto worker = [] (iter b, iter e) {
+        std::string ret;
+        for(auto it = b; it != e; ++it) {
+            std::this_thread::yield();
+            ret += *it;
+        }
+        return ret;
+    };
+    auto joiner = [] (const std::string& a, const std::string& b) { return a + b; };
+
+    auto sorted = [] (std::string s) { std::sort(s.begin(), s.end()); return s; }; // stolen chunks join out of order
+    auto expected = sorted(std::string(v.begin(), v.end()));
+    CHECK(sorted(bam::parallel_reduce(v.begin(), v.end(), worker, joiner)) == expected);
+    CHECK(sorted(bam::parallel_reduce(v.begin(), v.end(), worker, joiner, bam::auto_partitioner().cost_hint(std::chrono::milliseconds(1)))) == expected);
+    CHECK(bam::parallel_reduce(v.begin(), v.begin() + 3, worker, joiner, bam::auto_partitioner().cost_hint(std::chrono::nanoseconds(1))) == "abc");
+}
@@ -0,0 +1,208 @@
+#include "../include/bam/parallel_scan.hpp"
+#include "catch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    // cheap enough to be run in blocks even on small ranges
+    bam::simple_partitioner fine_blocks(int grainsize) {
+        return bam::simple_partitioner(grainsize).cost_hint(std::chrono::milliseconds(1));
+    }
+}
+
+TEST_CASE("parallel_scan/1", "parallel_inclusive_scan agrees with std::partial_sum") {
+    for(auto size : { 0, 1, 2, 63, 1000, 100000 }) {
+        std::vector<int> v(size);
+        std::iota(v.begin(), v.end(), -17);
+        std::vector<int> expected(size);
+        std::partial_sum(v.begin(), v.end(), expected.begin());
+
+        std::vector<int> out(size);
+        CHECK(bam::parallel_inclusive_scan(v.begin(), v.end(), out.begin()) == out.end());
+        CHECK(out == expected);
+
+        std::fill(out.begin(), out.end(), 0);
+        bam::parallel_inclusive_scan(v, out.begin(), std::plus<int>(), 7);
+        CHECK(out == expected);
+
+        std::fill(out.begin(), out.end(), 0);
+        bam::parallel_inclusive_scan(v, out.begin(), std::plus<int>(), fine_blocks(1000));
+        CHECK(out == expected);
+
+        std::fill(out.begin(), out.end(), 0);
+        bam::parallel_inclusive_scan(v.begin(), v.end(), out.begin(), std::plus<int>(), bam::auto_partitioner());
+        CHECK(out == expected);
+
+        // in place
+        bam::parallel_inclusive_scan(v, v.begin(), std::plus<int>(), fine_blocks(3));
+        CHECK(v == expected);
+    }
+}
+
+TEST_CASE("parallel_scan/2", "custom operators need not be commutative") {
+    std::string letters;
+    for(int i = 0; i != 3000; ++i) {
+        letters += static_cast<char>('a' + i % 26);
+    }
+    std::vector<std::string> v;
+    for(auto c : letters) {
+        v.push_back(std::string(1, c));
+    }
+
+    std::vector<std::string> out(v.size());
+    bam::parallel_inclusive_scan(v.begin(), v.end(), out.begin(), [] (const std::string& a, const std::string& b) { return a + b; }, fine_blocks(5));
+    for(auto i = 0u; i < out.size(); i += 97) {
+        CHECK(out[i] == letters.substr(0, i + 1));
+    }
+    CHECK(out.back() == letters);
+
+    std::vector<int> w(10000);
+    std::iota(w.begin(), w.end(), 0);
+    std::reverse(w.begin() + 5000, w.end());
+    std::vector<int> running_max(w.size());
+    bam::parallel_inclusive_scan(w, running_max.begin(), [] (int a, int b) { return std::max(a, b); }, 100);
+    CHECK(running_max[4999] == 4999);
+    CHECK(running_max[5000] == 9999);
+    CHECK(running_max.back() == 9999);
+}
+
+TEST_CASE("parallel_scan/3", "parallel_exclusive_scan starts from init") {
+    for(auto size : { 0, 1, 2, 1000, 100000 }) {
+        std::vector<long> v(size, 3);
+        std::vector<long> expected(size);
+        long sum = 10;
+        for(auto i = 0; i != size; ++i) {
+            expected[i] = sum;
+            sum += v[i];
+        }
+
+        std::vector<long> out(size);
+        CHECK(bam::parallel_exclusive_scan(v.begin(), v.end(), out.begin(), 10l) == out.end());
+        CHECK(out == expected);
+
+        std::fill(out.begin(), out.end(), 0);
+        bam::parallel_exclusive_scan(v, out.begin(), 10l, std::plus<long>(), fine_blocks(9));
+        CHECK(out == expected);
+
+        std::fill(out.begin(), out.end(), 0);
+        bam::parallel_exclusive_scan(v.begin(), v.end(), out.begin(), 10l, std::plus<long>(), 11);
+        CHECK(out == expected);
+
+        // in place, e.g. bucket counts to bucket offsets
+        bam::parallel_exclusive_scan(v, v.begin(), 10l);
+        CHECK(v == expected);
+    }
+}
+
+TEST_CASE("parallel_scan/4", "segmented scans restart at every head") {
+    std::vector<int> v(20000, 1);
+    std::vector<bool> heads(v.size(), false);
+    std::vector<int> expected(v.size());
+    int run = 0;
+    for(auto i = 0u; i != v.size(); ++i) {
+        // segments of growing length, some of them cross block borders
+        heads[i] = i % 997 == 0 || i % 13 == 5;
+        run = heads[i] ? 1 : run + 1;
+        expected[i] = run;
+    }
+
+    std::vector<int> out(v.size());
+    CHECK(bam::parallel_segmented_inclusive_scan(v.begin(), v.end(), heads.begin(), out.begin()) == out.end());
+    CHECK(out == expected);
+
+    std::fill(out.begin(), out.end(), 0);
+    bam::parallel_segmented_inclusive_scan(v, heads.begin(), out.begin(), std::plus<int>(), fine_blocks(4));
+    CHECK(out == expected);
+
+    std::fill(out.begin(), out.end(), 0);
+    bam::parallel_segmented_inclusive_scan(v, heads.begin(), out.begin(), std::plus<int>(), 500);
+    CHECK(out == expected);
+
+    // without any head, the first element still starts a segment
+    std::vector<char> none(v.size(), 0);
+    bam::parallel_segmented_inclusive_scan(v.begin(), v.end(), none.begin(), v.begin(), std::plus<int>(), bam::auto_partitioner());
+    CHECK(v.back() == static_cast<int>(v.size()));
+    CHECK(v[77] == 78);
+}
+
+TEST_CASE("parallel_scan/5", "exceptions and cancellation stop the scan") {
+    std::vector<int> v(10000, 1);
+    std::vector<int> out(v.size());
+    auto throwing = [] (int a, int b) -> int {
+        if(b == 2) {
+            throw std::runtime_error("two");
+        }
+        return a + b;
+    };
+    v[6000] = 2;
+    CHECK_THROWS_AS(bam::parallel_inclusive_scan(v, out.begin(), throwing, fine_blocks(100)), std::runtime_error);
+    CHECK_THROWS_AS(bam::parallel_inclusive_scan(v, out.begin(), throwing, fine_blocks(100).collect_exceptions()), bam::aggregate_exception);
+
+    bam::cancellation_source source;
+    source.cancel();
+    CHECK_THROWS_AS(bam::parallel_exclusive_scan(v, out.begin(), 0, std::plus<int>(), bam::auto_partitioner().cancel_with(source.token())), bam::operation_cancelled);
+}
+
+namespace {
+    // no default constructor, every value handed to the operator has to come from the input
+    struct counted {
+        explicit counted(int n_) : n(n_) {}
+        int n;
+    };
+}
+
+TEST_CASE("parallel_scan/6", "only values built from the input reach the operator") {
+    std::vector<counted> v(5000, counted(1));
+    std::vector<counted> out(v.size(), counted(0));
+    std::atomic<int> bad_operands(0);
+    auto add = [&] (const counted& a, const counted& b) {
+        if(a.n <= 0 || b.n <= 0) {
+            ++bad_operands;
+        }
+        return counted(a.n + b.n);
+    };
+
+    bam::parallel_inclusive_scan(v, out.begin(), add, fine_blocks(64));
+    CHECK(out.back().n == 5000);
+    CHECK(out[63].n == 64);
+
+    bam::parallel_exclusive_scan(v.begin(), v.end(), out.begin(), counted(1), add, bam::auto_partitioner());
+    CHECK(out.front().n == 1);
+    CHECK(out.back().n == 5000);
+    CHECK(bad_operands == 0);
+}
+
+TEST_CASE("parallel_scan/7", "grainsize 1 on a large range") {
+    std::vector<long long> v(1 << 19, 1);
+    std::vector<long long> out(v.size());
+    bam::parallel_inclusive_scan(v, out.begin(), std::plus<long long>(), fine_blocks(1));
+    CHECK(out.front() == 1);
+    CHECK(out[12345] == 12346);
+    CHECK(out.back() == static_cast<long long>(v.size()));
+
+    bam::parallel_exclusive_scan(v.begin(), v.end(), out.begin(), 0ll, std::plus<long long>(), 1);
+    CHECK(out.front() == 0);
+    CHECK(out.back() == static_cast<long long>(v.size()) - 1);
+}
+
+TEST_CASE("parallel_scan/8", "repeated scans with an affinity_partitioner replay its record") {
+    std::vector<int> v(100000, 1);
+    std::vector<int> out(v.size());
+    bam::affinity_partitioner part;
+    part.cost_hint(std::chrono::milliseconds(1));
+    for(int i = 0; i != 5; ++i) {
+        std::fill(out.begin(), out.end(), 0);
+        bam::parallel_inclusive_scan(v, out.begin(), std::plus<int>(), part);
+        CHECK(out.back() == static_cast<int>(v.size()));
+        CHECK(out[777] == 778);
+    }
+    // the pool only runs the scan if it has workers, then the blocks it ran are remembered for the next call
+    auto dispatched = bam::detail::get_worker_pool().active_size() != 0;
+    CHECK(bam::detail::partitioner_access::record(part).slots.empty() == !dispatched);
+}
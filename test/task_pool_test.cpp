@@ -1,7 +1,13 @@
 #include "../include/bam/task_pool.hpp"
 #include "catch.hpp"
 
+#include <array>
+#include <atomic>
+#include <mutex>
 #include <numeric>
+#include <set>
+#include <string>
+#include <thread>
 
 TEST_CASE("task_pool/1", "task_pool add one task") {
   std::vector<int> v(1, 1);
@@ -49,3 +55,104 @@ TEST_CASE("task_pool/5", "adding methods which throw") {
   CHECK_THROWS_AS(ret1.get(), std::runtime_error);
   CHECK_THROWS_AS(ret2.get(), std::runtime_error);
 }
+
+TEST_CASE("task_pool/6", "tasks adding tasks to their own worker") {
+  std::atomic<int> counter(0);
+  bam::task_pool pool;
+  std::vector<bam::future<void>> outer;
+  for(int i = 0; i != 100; ++i) {
+    outer.push_back(pool.add([&] () {
+      for(int j = 0; j != 100; ++j) {
+        pool.add([&] () { ++counter; });
+      }
+    }));
+  }
+  for(auto& f : outer) {
+    f.get();
+  }
+  pool.wait();
+  CHECK(counter.load() == 100 * 100);
+}
+
+TEST_CASE("task_pool/7", "tasks with captures larger than the inline storage of function_wrapper") {
+  std::atomic<int> counter(0);
+  std::array<int, 64> large;
+  large.fill(1);
+  std::string name("a string is not trivially copyable");
+  bam::task_pool pool;
+  for(int i = 0; i != 100; ++i) {
+    pool.add([&counter, large] { counter += large[63]; });
+    pool.add([&counter, name] { counter += name.empty() ? 0 : 1; });
+  }
+  pool.wait();
+  CHECK(counter.load() == 200);
+}
+
+TEST_CASE("task_pool/8", "many producer threads") {
+  std::atomic<int> counter(0);
+  bam::task_pool pool;
+  std::vector<std::thread> producers;
+  for(int p = 0; p != 16; ++p) {
+    producers.emplace_back([&] {
+      for(int i = 0; i != 1000; ++i) {
+        pool.add([&] { ++counter; });
+      }
+    });
+  }
+  for(auto& t : producers) {
+    t.join();
+  }
+  pool.wait();
+  CHECK(counter.load() == 16 * 1000);
+}
+
+TEST_CASE("task_pool/9", "every wait strategy, with tasks arriving after the workers went idle") {
+  for(auto strategy : { bam::wait_strategy::blocking, bam::wait_strategy::spin_then_park, bam::wait_strategy::busy_poll }) {
+    bam::task_pool pool(strategy, 10);
+    for(int round = 0; round != 20; ++round) {
+      auto f = pool.add([=] { return round; });
+      CHECK(f.get() == round);
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+    pool.wait_and_finish();
+  }
+}
+
+TEST_CASE("task_pool/10", "wait covers tasks added by tasks and keeps the workers alive") {
+  std::atomic<int> counter(0);
+  std::mutex m;
+  std::set<std::thread::id> ids;
+  bam::task_pool pool;
+  for(int batch = 1; batch <= 50; ++batch) {
+    for(int i = 0; i != 10; ++i) {
+      pool.add([&] {
+        {
+          std::lock_guard<std::mutex> lock(m);
+          ids.insert(std::this_thread::get_id());
+        }
+        pool.add([&] { ++counter; });
+      });
+    }
+    pool.wait();
+    CHECK(counter == batch * 10);
+  }
+  CHECK(ids.size() <= static_cast<std::size_t>(bam::detail::get_threadcount()) + 1);
+}
+
+TEST_CASE("task_pool/11", "tasks dropped with their work_pool break their promise") {
+  bam::future<int> small;
+  bam::future<std::string> large;
+  {
+    bam::detail::work_pool work;
+    auto inline_task = bam::detail::make_promised_task([] { return 1; });
+    small = std::move(inline_task.second);
+    work.push_back(bam::detail::function_wrapper(std::move(inline_task.first)));
+
+    std::string text(100, 'x');
+    auto heap_task = bam::detail::make_promised_task([text] { return text; });
+    large = std::move(heap_task.second);
+    work.push_local(std::move(heap_task.first));
+  }
+  CHECK_THROWS_AS(small.get(), std::future_error);
+  CHECK_THROWS_AS(large.get(), std::future_error);
+}